@@ -0,0 +1,184 @@
+#include "Alignment.h"
+#include "FFT.h"
+#include "SampleView.h"
+#include "WavReader.h"
+
+#include <cmath>
+#include <stdexcept>
+
+namespace Dsp {
+namespace {
+const size_t COARSE_LIMIT = 1lu << 18lu;
+const size_t REFINE_SIZE = 1lu << 16lu;
+
+// The smallest even size >= n with no prime factor above 5, which keeps the
+// real plans on the packed mixed-radix path.
+size_t FastSize(size_t n) {
+  size_t best = SIZE_MAX;
+  for (size_t a = 2; a < 2 * n + 2; a *= 2) {
+    for (size_t b = a; b < 2 * n + 2; b *= 3) {
+      for (size_t c = b; c < 2 * n + 2; c *= 5) {
+        if (c >= n) {
+          best = std::min(best, c);
+        }
+      }
+    }
+  }
+  return best;
+}
+
+// Averages all channels of `count` frames starting at `first`.
+void ReadMono(const Wav::File &file, size_t first, size_t count,
+              std::vector<double> &out) {
+  const auto &header = file.GetHeader();
+  out.resize(count);
+  Wav::MixSamples(file.Data().data + first * header.blockAlign, count, header,
+                  out.data());
+}
+
+// Averages of `factor` consecutive mono frames, read in bounded blocks.
+std::vector<double> Decimate(const Wav::File &file, size_t factor) {
+  const size_t BLOCK_FRAMES = 1lu << 16lu;
+  size_t frames = file.Samples<double>(0).size();
+  std::vector<double> decimated((frames + factor - 1) / factor, 0.);
+  std::vector<double> block;
+  for (size_t first = 0; first < frames; first += BLOCK_FRAMES * factor) {
+    size_t count = std::min(BLOCK_FRAMES * factor, frames - first);
+    ReadMono(file, first, count, block);
+    for (size_t i = 0; i < count; ++i) {
+      decimated[(first + i) / factor] += block[i] / factor;
+    }
+  }
+  return decimated;
+}
+
+double Energy(const double *samples, size_t count) {
+  double energy = 0;
+  for (size_t i = 0; i < count; ++i) {
+    energy += samples[i] * samples[i];
+  }
+  return energy;
+}
+} // namespace
+
+std::vector<double> CrossCorrelate(const std::vector<double> &a,
+                                   const std::vector<double> &b) {
+  if (a.empty() || b.empty()) {
+    return {};
+  }
+  size_t size = FastSize(a.size() + b.size() - 1);
+  auto plan = FFT::GetRealPlan<double>(size);
+  std::vector<double> padded(size, 0.);
+  std::vector<std::complex<double>> spectrumA(plan->SpectrumSize());
+  std::vector<std::complex<double>> spectrumB(plan->SpectrumSize());
+  std::copy(a.begin(), a.end(), padded.begin());
+  plan->Forward(padded.data(), spectrumA.data());
+  std::fill(padded.begin(), padded.end(), 0.);
+  std::copy(b.begin(), b.end(), padded.begin());
+  plan->Forward(padded.data(), spectrumB.data());
+  for (size_t i = 0; i < spectrumA.size(); ++i) {
+    spectrumA[i] = std::conj(spectrumA[i]) * spectrumB[i];
+  }
+  plan->Inverse(spectrumA.data(), padded.data());
+
+  // Negative lags wrapped around to the end of the circular result.
+  std::vector<double> correlation(a.size() + b.size() - 1);
+  for (size_t i = 0; i < correlation.size(); ++i) {
+    int64_t lag = int64_t(i) - int64_t(a.size() - 1);
+    correlation[i] = padded[lag < 0 ? size + lag : lag];
+  }
+  return correlation;
+}
+
+Alignment AlignFiles(const std::string &referencePath,
+                     const std::string &otherPath) {
+  Wav::File reference, other;
+  reference.Map(referencePath);
+  other.Map(otherPath);
+  if (reference.GetHeader().sampleRate != other.GetHeader().sampleRate) {
+    throw std::invalid_argument("Sample rates don't match!");
+  }
+  size_t referenceFrames = reference.Samples<double>(0).size();
+  size_t otherFrames = other.Samples<double>(0).size();
+  if (referenceFrames == 0 || otherFrames == 0) {
+    throw std::invalid_argument("Can't align an empty file!");
+  }
+
+  // Coarse pass over block averages of both files.
+  size_t longest = std::max(referenceFrames, otherFrames);
+  size_t factor = (longest + COARSE_LIMIT - 1) / COARSE_LIMIT;
+  auto coarseReference = Decimate(reference, factor);
+  auto coarseOther = Decimate(other, factor);
+  auto correlation = CrossCorrelate(coarseReference, coarseOther);
+  size_t peak = 0;
+  for (size_t i = 1; i < correlation.size(); ++i) {
+    if (correlation[i] > correlation[peak]) {
+      peak = i;
+    }
+  }
+  int64_t coarseLag =
+      (int64_t(peak) - int64_t(coarseReference.size() - 1)) * int64_t(factor);
+
+  // Refined pass around the coarse lag. The reference window is the one
+  // with the most energy among those that overlap the other file.
+  int64_t margin = 2 * int64_t(factor);
+  int64_t first = std::max<int64_t>(0, -coarseLag);
+  int64_t last = std::min<int64_t>(referenceFrames, otherFrames - coarseLag);
+  if (last <= first) {
+    first = 0;
+    last = referenceFrames;
+  }
+  size_t window = std::min<size_t>(REFINE_SIZE, last - first);
+  size_t start = first;
+  double bestEnergy = -1;
+  for (size_t candidate = first; candidate + window <= size_t(last);
+       candidate += window / 2 + 1) {
+    size_t begin = candidate / factor;
+    size_t end = std::min(coarseReference.size(),
+                          (candidate + window + factor - 1) / factor);
+    double energy = Energy(coarseReference.data() + begin, end - begin);
+    if (energy > bestEnergy) {
+      bestEnergy = energy;
+      start = candidate;
+    }
+  }
+
+  std::vector<double> referenceWindow, otherWindow;
+  ReadMono(reference, start, window, referenceWindow);
+  int64_t otherStart = std::max<int64_t>(0, int64_t(start) + coarseLag - margin);
+  int64_t otherEnd = std::min<int64_t>(
+      otherFrames, int64_t(start + window) + coarseLag + margin);
+  if (otherEnd <= otherStart) {
+    return {coarseLag, 0.};
+  }
+  ReadMono(other, otherStart, otherEnd - otherStart, otherWindow);
+  correlation = CrossCorrelate(referenceWindow, otherWindow);
+
+  // Every lag is scored against the energy of the samples it overlaps.
+  std::vector<double> otherEnergy(otherWindow.size() + 1, 0.);
+  for (size_t i = 0; i < otherWindow.size(); ++i) {
+    otherEnergy[i + 1] = otherEnergy[i] + otherWindow[i] * otherWindow[i];
+  }
+  double referenceEnergy = Energy(referenceWindow.data(), window);
+  Alignment best{coarseLag, -2.};
+  for (int64_t lag = coarseLag - margin; lag <= coarseLag + margin; ++lag) {
+    // Offset of reference sample `start` inside the other window.
+    int64_t offset = int64_t(start) + lag - otherStart;
+    int64_t index = offset + int64_t(window) - 1;
+    if (index < 0 || index >= int64_t(correlation.size())) {
+      continue;
+    }
+    int64_t begin = std::max<int64_t>(0, offset);
+    int64_t end =
+        std::min<int64_t>(otherWindow.size(), offset + int64_t(window));
+    double norm = std::sqrt(referenceEnergy *
+                            (end > begin ? otherEnergy[end] - otherEnergy[begin]
+                                         : 0.));
+    double score = norm > 0 ? correlation[index] / norm : 0.;
+    if (score > best.score) {
+      best = {lag, score};
+    }
+  }
+  return best;
+}
+} // namespace Dsp
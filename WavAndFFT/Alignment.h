@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Dsp {
+struct Alignment {
+  // `other` matches `reference` when delayed by `lag` frames; a negative
+  // lag means it starts early.
+  int64_t lag = 0;
+  // Normalised correlation at the lag, 1 for an exact (scaled) copy.
+  double score = 0;
+};
+
+// c[k + a.size() - 1] = sum a[n] * b[n + k] for k in (-a.size(), b.size()),
+// computed with real FFTs and a conjugate multiply.
+std::vector<double> CrossCorrelate(const std::vector<double> &a,
+                                   const std::vector<double> &b);
+
+// Finds the lag between the channel averages of two WAV files. The first
+// pass correlates block averages of at most 2^18 points per file; the second
+// correlates a full-rate window of 2^16 frames around the coarse lag, so
+// hour-long inputs cost about two FFTs of those sizes.
+Alignment AlignFiles(const std::string &referencePath,
+                     const std::string &otherPath);
+} // namespace Dsp
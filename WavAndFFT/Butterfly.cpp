@@ -0,0 +1,163 @@
+#include "Butterfly.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FFT_X86_KERNELS
+#endif
+
+namespace FFT {
+namespace {
+template <typename T>
+void ButterflyRange(std::complex<T> *evens, const std::complex<T> *twiddles,
+                    size_t begin, size_t half) {
+  T *e = reinterpret_cast<T *>(evens);
+  T *o = reinterpret_cast<T *>(evens + half);
+  const T *w = reinterpret_cast<const T *>(twiddles);
+  for (size_t i = begin; i < half; ++i) {
+    T re = w[2 * i] * o[2 * i] - w[2 * i + 1] * o[2 * i + 1];
+    T im = w[2 * i] * o[2 * i + 1] + w[2 * i + 1] * o[2 * i];
+    o[2 * i] = e[2 * i] - re;
+    o[2 * i + 1] = e[2 * i + 1] - im;
+    e[2 * i] += re;
+    e[2 * i + 1] += im;
+  }
+}
+
+template <typename T>
+void ButterflyScalar(std::complex<T> *data, size_t size, size_t half,
+                     const std::complex<T> *twiddles) {
+  for (size_t start = 0; start < size; start += 2 * half) {
+    ButterflyRange(data + start, twiddles, 0, half);
+  }
+}
+
+#ifdef FFT_X86_KERNELS
+__attribute__((target("sse3"))) void
+ButterflySse3(std::complex<double> *data, size_t size, size_t half,
+              const std::complex<double> *twiddles) {
+  const double *w = reinterpret_cast<const double *>(twiddles);
+  for (size_t start = 0; start < size; start += 2 * half) {
+    double *e = reinterpret_cast<double *>(data + start);
+    double *o = e + 2 * half;
+    for (size_t i = 0; i < half; ++i) {
+      __m128d tw = _mm_loadu_pd(w + 2 * i);
+      __m128d x = _mm_loadu_pd(o + 2 * i);
+      __m128d re = _mm_movedup_pd(tw);
+      __m128d im = _mm_unpackhi_pd(tw, tw);
+      __m128d swapped = _mm_shuffle_pd(x, x, 1);
+      __m128d product =
+          _mm_addsub_pd(_mm_mul_pd(re, x), _mm_mul_pd(im, swapped));
+      __m128d even = _mm_loadu_pd(e + 2 * i);
+      _mm_storeu_pd(e + 2 * i, _mm_add_pd(even, product));
+      _mm_storeu_pd(o + 2 * i, _mm_sub_pd(even, product));
+    }
+  }
+}
+
+__attribute__((target("avx2,fma"))) void
+ButterflyAvx2(std::complex<double> *data, size_t size, size_t half,
+              const std::complex<double> *twiddles) {
+  const double *w = reinterpret_cast<const double *>(twiddles);
+  size_t vectorized = half & ~size_t(1);
+  for (size_t start = 0; start < size; start += 2 * half) {
+    double *e = reinterpret_cast<double *>(data + start);
+    double *o = e + 2 * half;
+    for (size_t i = 0; i < vectorized; i += 2) {
+      __m256d tw = _mm256_loadu_pd(w + 2 * i);
+      __m256d x = _mm256_loadu_pd(o + 2 * i);
+      __m256d re = _mm256_movedup_pd(tw);
+      __m256d im = _mm256_permute_pd(tw, 0xF);
+      __m256d swapped = _mm256_permute_pd(x, 0x5);
+      __m256d product =
+          _mm256_fmaddsub_pd(re, x, _mm256_mul_pd(im, swapped));
+      __m256d even = _mm256_loadu_pd(e + 2 * i);
+      _mm256_storeu_pd(e + 2 * i, _mm256_add_pd(even, product));
+      _mm256_storeu_pd(o + 2 * i, _mm256_sub_pd(even, product));
+    }
+    ButterflyRange(data + start, twiddles, vectorized, half);
+  }
+}
+
+__attribute__((target("sse3"))) void
+ButterflySse3(std::complex<float> *data, size_t size, size_t half,
+              const std::complex<float> *twiddles) {
+  const float *w = reinterpret_cast<const float *>(twiddles);
+  size_t vectorized = half & ~size_t(1);
+  for (size_t start = 0; start < size; start += 2 * half) {
+    float *e = reinterpret_cast<float *>(data + start);
+    float *o = e + 2 * half;
+    for (size_t i = 0; i < vectorized; i += 2) {
+      __m128 tw = _mm_loadu_ps(w + 2 * i);
+      __m128 x = _mm_loadu_ps(o + 2 * i);
+      __m128 re = _mm_moveldup_ps(tw);
+      __m128 im = _mm_movehdup_ps(tw);
+      __m128 swapped = _mm_shuffle_ps(x, x, 0xB1);
+      __m128 product = _mm_addsub_ps(_mm_mul_ps(re, x), _mm_mul_ps(im, swapped));
+      __m128 even = _mm_loadu_ps(e + 2 * i);
+      _mm_storeu_ps(e + 2 * i, _mm_add_ps(even, product));
+      _mm_storeu_ps(o + 2 * i, _mm_sub_ps(even, product));
+    }
+    ButterflyRange(data + start, twiddles, vectorized, half);
+  }
+}
+
+__attribute__((target("avx2,fma"))) void
+ButterflyAvx2(std::complex<float> *data, size_t size, size_t half,
+              const std::complex<float> *twiddles) {
+  const float *w = reinterpret_cast<const float *>(twiddles);
+  size_t vectorized = half & ~size_t(3);
+  for (size_t start = 0; start < size; start += 2 * half) {
+    float *e = reinterpret_cast<float *>(data + start);
+    float *o = e + 2 * half;
+    for (size_t i = 0; i < vectorized; i += 4) {
+      __m256 tw = _mm256_loadu_ps(w + 2 * i);
+      __m256 x = _mm256_loadu_ps(o + 2 * i);
+      __m256 re = _mm256_moveldup_ps(tw);
+      __m256 im = _mm256_movehdup_ps(tw);
+      __m256 swapped = _mm256_permute_ps(x, 0xB1);
+      __m256 product = _mm256_fmaddsub_ps(re, x, _mm256_mul_ps(im, swapped));
+      __m256 even = _mm256_loadu_ps(e + 2 * i);
+      _mm256_storeu_ps(e + 2 * i, _mm256_add_ps(even, product));
+      _mm256_storeu_ps(o + 2 * i, _mm256_sub_ps(even, product));
+    }
+    ButterflyRange(data + start, twiddles, vectorized, half);
+  }
+}
+
+bool HasAvx2() {
+  return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+}
+
+bool HasSse3() { return __builtin_cpu_supports("sse3"); }
+#endif
+} // namespace
+
+template <> ButterflyKernel<float> SelectButterflyKernel<float>() {
+#ifdef FFT_X86_KERNELS
+  if (HasAvx2()) {
+    return ButterflyAvx2;
+  }
+  if (HasSse3()) {
+    return ButterflySse3;
+  }
+#endif
+  return ButterflyScalar<float>;
+}
+
+template <> ButterflyKernel<double> SelectButterflyKernel<double>() {
+#ifdef FFT_X86_KERNELS
+  if (HasAvx2()) {
+    return ButterflyAvx2;
+  }
+  if (HasSse3()) {
+    return ButterflySse3;
+  }
+#endif
+  return ButterflyScalar<double>;
+}
+
+// The x87 extended type has no vector registers; it stays the reference path.
+template <> ButterflyKernel<long double> SelectButterflyKernel<long double>() {
+  return ButterflyScalar<long double>;
+}
+} // namespace FFT
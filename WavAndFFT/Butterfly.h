@@ -0,0 +1,14 @@
+#pragma once
+
+#include <complex>
+
+namespace FFT {
+// Runs one radix-2 pass over `size` points: every block of 2 * half points
+// is combined with the `half` twiddles of that pass.
+template <typename T>
+using ButterflyKernel = void (*)(std::complex<T> *data, size_t size,
+                                 size_t half, const std::complex<T> *twiddles);
+
+// Picks the widest kernel the running CPU supports.
+template <typename T> ButterflyKernel<T> SelectButterflyKernel();
+} // namespace FFT
@@ -0,0 +1,69 @@
+#include "ChunkIterator.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace Wav {
+namespace {
+const uint32_t SIZE_PLACEHOLDER = 0xFFFFFFFF;
+
+template <typename T> T FromBytes(const char *bytes) {
+  T res = 0;
+  std::memcpy(&res, bytes, sizeof(T));
+  return res;
+}
+} // namespace
+
+ChunkIterator::ChunkIterator(std::istream &stream) : _stream(stream) {
+  char riff[12];
+  _stream.seekg(0);
+  if (!_stream.read(riff, sizeof(riff))) {
+    throw std::runtime_error("File is too short for a wav header!");
+  }
+  _riffId.assign(riff, 4);
+  _isRf64 = _riffId == "RF64" || _riffId == "BW64";
+  if ((_riffId != "RIFF" && !_isRf64) || std::string(riff + 8, 4) != "WAVE") {
+    throw std::runtime_error("File is not a RIFF WAVE file!");
+  }
+  _riffSize = FromBytes<uint32_t>(riff + 4);
+  if (!_isRf64) {
+    return;
+  }
+  Chunk ds64{};
+  if (!Next(ds64) || ds64.id != "ds64" || ds64.size < 16) {
+    throw std::runtime_error("RF64 file has no ds64 chunk!");
+  }
+  auto body = ReadBody(ds64, 16);
+  _riffSize = FromBytes<uint64_t>(reinterpret_cast<char *>(body.data()));
+  _dataSize = FromBytes<uint64_t>(reinterpret_cast<char *>(body.data()) + 8);
+}
+
+bool ChunkIterator::Next(Chunk &chunk) {
+  char header[8];
+  _stream.clear();
+  _stream.seekg(_next);
+  if (!_stream.read(header, sizeof(header))) {
+    return false;
+  }
+  chunk.id.assign(header, 4);
+  chunk.offset = _next + sizeof(header);
+  chunk.size = FromBytes<uint32_t>(header + 4);
+  if (_isRf64 && chunk.id == "data" && chunk.size == SIZE_PLACEHOLDER) {
+    chunk.size = _dataSize;
+  }
+  // Chunk bodies are padded to an even length.
+  _next = chunk.offset + chunk.size + (chunk.size & 1u);
+  return true;
+}
+
+std::vector<uint8_t> ChunkIterator::ReadBody(const Chunk &chunk,
+                                             size_t limit) {
+  std::vector<uint8_t> body(std::min<uint64_t>(chunk.size, limit));
+  _stream.clear();
+  _stream.seekg(chunk.offset);
+  _stream.read(reinterpret_cast<char *>(body.data()), body.size());
+  body.resize(_stream.gcount());
+  return body;
+}
+} // namespace Wav
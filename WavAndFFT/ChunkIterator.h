@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace Wav {
+struct Chunk {
+  std::string id;
+  // Position of the chunk body from the start of the stream.
+  uint64_t offset;
+  uint64_t size;
+};
+
+// Walks the chunks of a RIFF or RF64 WAVE stream. Only chunk headers are
+// read; bodies are skipped by seeking, so arbitrary metadata before or after
+// the audio costs nothing. For RF64 the 64-bit sizes of the `ds64` chunk
+// replace the 0xFFFFFFFF placeholders of the RIFF and `data` chunks.
+class ChunkIterator {
+public:
+  explicit ChunkIterator(std::istream &stream);
+
+  const std::string &RiffId() const { return _riffId; }
+  bool IsRf64() const { return _isRf64; }
+  uint64_t RiffSize() const { return _riffSize; }
+
+  // Moves to the next chunk; returns false once the stream is exhausted.
+  bool Next(Chunk &chunk);
+
+  // Reads at most `limit` bytes of the body of `chunk`.
+  std::vector<uint8_t> ReadBody(const Chunk &chunk, size_t limit = SIZE_MAX);
+
+private:
+  std::istream &_stream;
+  std::string _riffId;
+  bool _isRf64 = false;
+  uint64_t _riffSize = 0;
+  uint64_t _dataSize = 0;
+  uint64_t _next = 12;
+};
+} // namespace Wav
@@ -0,0 +1,149 @@
+#include "Convolver.h"
+#include "SampleView.h"
+#include "WavWriter.h"
+
+#include <stdexcept>
+
+namespace Dsp {
+PartitionedConvolver::PartitionedConvolver(const std::vector<double> &impulse,
+                                           size_t blockSize)
+    : _plan(FFT::GetRealPlan<double>(2 * blockSize)),
+      _impulseSize(impulse.size()) {
+  if (blockSize == 0 || impulse.empty()) {
+    throw std::invalid_argument("Convolver needs a block and a response!");
+  }
+  _bins = _plan->SpectrumSize();
+  _partitionCount = (impulse.size() + blockSize - 1) / blockSize;
+  _partitions.resize(_partitionCount * _bins);
+  _frame.resize(2 * blockSize);
+  for (size_t p = 0; p < _partitionCount; ++p) {
+    std::fill(_frame.begin(), _frame.end(), 0.);
+    size_t begin = p * blockSize;
+    size_t end = std::min(impulse.size(), begin + blockSize);
+    std::copy(impulse.begin() + begin, impulse.begin() + end, _frame.begin());
+    _plan->Forward(_frame.data(), _partitions.data() + p * _bins);
+  }
+  _delayLine.resize(_partitionCount * _bins);
+  _accumulator.resize(_bins);
+  _input.resize(2 * blockSize);
+  Reset();
+}
+
+void PartitionedConvolver::Reset() {
+  std::fill(_delayLine.begin(), _delayLine.end(), std::complex<double>());
+  std::fill(_input.begin(), _input.end(), 0.);
+  _head = 0;
+  _filled = 0;
+  _consumed = 0;
+  _emitted = 0;
+}
+
+void PartitionedConvolver::Process(const double *in, size_t count,
+                                   std::vector<double> &out) {
+  size_t blockSize = BlockSize();
+  _consumed += count;
+  while (count > 0) {
+    size_t taken = std::min(count, blockSize - _filled);
+    std::copy(in, in + taken, _input.begin() + blockSize + _filled);
+    _filled += taken;
+    in += taken;
+    count -= taken;
+    if (_filled == blockSize) {
+      ProcessBlock(out, UINT64_MAX);
+    }
+  }
+}
+
+// The newest input spectrum goes to the head of the delay line, so the
+// partition p is paired with the spectrum of the block p steps back.
+void PartitionedConvolver::ProcessBlock(std::vector<double> &out,
+                                        uint64_t limit) {
+  size_t blockSize = BlockSize();
+  _head = (_head + _partitionCount - 1) % _partitionCount;
+  _plan->Forward(_input.data(), _delayLine.data() + _head * _bins);
+
+  std::fill(_accumulator.begin(), _accumulator.end(), std::complex<double>());
+  auto *sum = reinterpret_cast<double *>(_accumulator.data());
+  for (size_t p = 0; p < _partitionCount; ++p) {
+    size_t slot = (_head + p) % _partitionCount;
+    const auto *x =
+        reinterpret_cast<const double *>(_delayLine.data() + slot * _bins);
+    const auto *h =
+        reinterpret_cast<const double *>(_partitions.data() + p * _bins);
+    for (size_t i = 0; i < 2 * _bins; i += 2) {
+      sum[i] += x[i] * h[i] - x[i + 1] * h[i + 1];
+      sum[i + 1] += x[i] * h[i + 1] + x[i + 1] * h[i];
+    }
+  }
+  _plan->Inverse(_accumulator.data(), _frame.data());
+
+  // The first half of the frame is corrupted by circular wrap-around.
+  for (size_t i = 0; i < blockSize && _emitted < limit; ++i, ++_emitted) {
+    out.push_back(_frame[blockSize + i]);
+  }
+  std::copy(_input.begin() + blockSize, _input.end(), _input.begin());
+  _filled = 0;
+}
+
+void PartitionedConvolver::Flush(std::vector<double> &out) {
+  size_t blockSize = BlockSize();
+  uint64_t total = _consumed > 0 ? _consumed + _impulseSize - 1 : 0;
+  while (_emitted < total) {
+    std::fill(_input.begin() + blockSize + _filled, _input.end(), 0.);
+    ProcessBlock(out, total);
+  }
+  Reset();
+}
+
+void ConvolveFile(const std::string &inputPath, const std::string &impulsePath,
+                  const std::string &outputPath, size_t blockSize) {
+  const size_t BLOCK_FRAMES = 1lu << 14lu;
+  Wav::File input, impulse;
+  input.Open(inputPath);
+  impulse.Map(impulsePath);
+  const auto &header = input.GetHeader();
+  const auto &impulseHeader = impulse.GetHeader();
+  if (impulseHeader.numChannels != 1 &&
+      impulseHeader.numChannels != header.numChannels) {
+    throw std::invalid_argument("Impulse response channels don't match!");
+  }
+  if (impulseHeader.sampleRate != header.sampleRate) {
+    throw std::invalid_argument("Impulse response sample rate doesn't match!");
+  }
+
+  std::vector<PartitionedConvolver> convolvers;
+  for (uint16_t channel = 0; channel < header.numChannels; ++channel) {
+    auto view = impulse.Samples<double>(
+        impulseHeader.numChannels == 1 ? 0 : channel);
+    convolvers.emplace_back(std::vector<double>(view.begin(), view.end()),
+                            blockSize);
+  }
+
+  Wav::Writer output(outputPath, header);
+  std::vector<Wav::File::Byte> block, result;
+  std::vector<double> samples, convolved;
+  auto convolveBlock = [&](bool isLast) {
+    size_t frames = block.size() / header.blockAlign;
+    for (uint16_t channel = 0; channel < header.numChannels; ++channel) {
+      Wav::SampleView<double> view(block.data(), frames, header, channel);
+      samples.resize(frames);
+      view.CopyTo(samples.data());
+      convolved.clear();
+      convolvers[channel].Process(samples.data(), frames, convolved);
+      if (isLast) {
+        convolvers[channel].Flush(convolved);
+      }
+      result.resize(convolved.size() * header.blockAlign);
+      Wav::StoreSamples(convolved.data(), convolved.size(), header, channel,
+                        result.data());
+    }
+    output.Write(result);
+  };
+  while (input.ReadBlock(block, BLOCK_FRAMES * header.blockAlign) > 0) {
+    convolveBlock(false);
+  }
+  block.clear();
+  convolveBlock(true);
+  output.Close();
+}
+} // namespace Dsp
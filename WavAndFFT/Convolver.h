@@ -0,0 +1,54 @@
+#pragma once
+
+#include "FFT.h"
+
+#include <string>
+#include <vector>
+
+namespace Dsp {
+// Uniformly partitioned overlap-save convolution. The impulse response is
+// cut into partitions of BlockSize() samples whose spectra are computed once;
+// every input block is transformed once, pushed into a frequency-domain
+// delay line and multiplied with all partition spectra, so the cost per
+// sample grows with the response length only through that accumulation.
+class PartitionedConvolver {
+public:
+  PartitionedConvolver(const std::vector<double> &impulse, size_t blockSize);
+
+  size_t BlockSize() const { return _plan->Size() / 2; }
+  size_t ImpulseSize() const { return _impulseSize; }
+
+  // Consumes `count` samples and appends every finished output sample to
+  // `out`; output lags input by less than one block.
+  void Process(const double *in, size_t count, std::vector<double> &out);
+
+  // Appends the tail so that in total input + impulse - 1 samples were
+  // produced, and resets the convolver.
+  void Flush(std::vector<double> &out);
+
+  void Reset();
+
+private:
+  std::shared_ptr<const FFT::BasicRealPlan<double>> _plan;
+  size_t _impulseSize;
+  size_t _partitionCount;
+  size_t _bins;
+  std::vector<std::complex<double>> _partitions;
+  std::vector<std::complex<double>> _delayLine;
+  std::vector<std::complex<double>> _accumulator;
+  std::vector<double> _input;
+  std::vector<double> _frame;
+  size_t _head = 0;
+  size_t _filled = 0;
+  uint64_t _consumed = 0;
+  uint64_t _emitted = 0;
+
+  void ProcessBlock(std::vector<double> &out, uint64_t limit);
+};
+
+// Convolves every channel of `inputPath` with the matching channel of
+// `impulsePath` (or its only channel) and streams the result to
+// `outputPath`, which gets the format of the input.
+void ConvolveFile(const std::string &inputPath, const std::string &impulsePath,
+                  const std::string &outputPath, size_t blockSize = 1024);
+} // namespace Dsp
@@ -1,41 +1,469 @@
 #include "FFT.h"
+#include "ParallelFFT.h"
+#include "PlanCache.h"
+#include "Trace.h"
+
+#include <cmath>
+#include <stdexcept>
 
 namespace FFT {
-void ComplementToPowerOfTwo(std::vector<Complex> &data) {
-  size_t n = 1;
-  while (n < data.size()) {
-    n <<= 1lu;
+namespace {
+template <typename T>
+std::complex<T> Multiply(const std::complex<T> &a, const std::complex<T> &b) {
+  return {a.real() * b.real() - a.imag() * b.imag(),
+          a.real() * b.imag() + a.imag() * b.real()};
+}
+
+template <typename T>
+std::complex<T> RootOfUnity(size_t power, size_t order, bool isInversed) {
+  long double ang = (isInversed ? -2 : 2) * M_PIl * (power % order) / order;
+  return {static_cast<T>(std::cos(ang)), static_cast<T>(std::sin(ang))};
+}
+
+// Nested plans may need scratch at the same time, so each user has a slot.
+enum ScratchSlot {
+  PERMUTATION_SLOT,
+  BLUESTEIN_SLOT,
+  REAL_SLOT,
+  BATCH_SLOT,
+  SLOT_COUNT
+};
+
+template <typename T>
+std::vector<std::complex<T>> &Scratch(ScratchSlot slot, size_t size) {
+  thread_local std::vector<std::complex<T>> scratch[SLOT_COUNT];
+  if (scratch[slot].size() < size) {
+    scratch[slot].resize(size);
+  }
+  return scratch[slot];
+}
+} // namespace
+
+template <typename T>
+BasicPlan<T>::BasicPlan(size_t size, bool isInversed)
+    : _size(size), _isInversed(isInversed),
+      _butterfly(SelectButterflyKernel<T>()) {
+  if (size == 0) {
+    throw std::invalid_argument("Plan size must be positive!");
+  }
+  ComputeStages();
+  if (_stages.empty() && _size > 1) {
+    ComputeChirp();
+    return;
   }
-  data.resize(n);
+  ComputePermutation();
 }
 
-std::vector<Complex> GeneralTransform(std::vector<Complex> data) {
+// Radix-2 stages come first so that they all have power-of-two spans and can
+// use the vectorised butterflies.
+template <typename T> void BasicPlan<T>::ComputeStages() {
+  std::vector<size_t> radices;
+  size_t rest = _size;
+  for (size_t radix : {2, 3, 5, 7}) {
+    while (rest % radix == 0) {
+      radices.push_back(radix);
+      rest /= radix;
+    }
+  }
+  if (rest != 1) {
+    return;
+  }
+  size_t span = 1;
+  for (size_t radix : radices) {
+    Stage stage{radix, span, _twiddles.size(), {}};
+    for (size_t i = 0; i < radix; ++i) {
+      stage.roots[i] = RootOfUnity<T>(i, radix, _isInversed);
+    }
+    for (size_t j = 0; j < span; ++j) {
+      for (size_t q = 1; q < radix; ++q) {
+        _twiddles.push_back(RootOfUnity<T>(q * j, radix * span, _isInversed));
+      }
+    }
+    _stages.push_back(stage);
+    span *= radix;
+  }
+}
+
+// Digit reversal: position p of the permuted buffer receives the sample whose
+// index has the mixed-radix digits of p in reverse order.
+template <typename T> void BasicPlan<T>::ComputePermutation() {
+  _permutation.resize(_size);
+  for (size_t position = 0; position < _size; ++position) {
+    size_t index = 0, weight = 1, rest = position, block = _size;
+    for (auto stage = _stages.rbegin(); stage != _stages.rend(); ++stage) {
+      block /= stage->radix;
+      index += rest / block * weight;
+      rest %= block;
+      weight *= stage->radix;
+    }
+    _permutation[position] = index;
+  }
+}
+
+// X[k] = c[k] * sum(x[n] * c[n] * conj(c[k - n])) with c[n] = w^(n^2 / 2), so
+// the transform becomes a power-of-two convolution with a fixed chirp.
+template <typename T> void BasicPlan<T>::ComputeChirp() {
+  size_t convolutionSize = 1;
+  while (convolutionSize < 2 * _size - 1) {
+    convolutionSize <<= 1lu;
+  }
+  _convolution = std::make_unique<BasicPlan>(convolutionSize);
+  _chirp.resize(_size);
+  for (size_t i = 0; i < _size; ++i) {
+    // i^2 is reduced modulo 2 * size to keep the angle exact.
+    size_t power = static_cast<size_t>(
+        static_cast<unsigned __int128>(i) * i % (2 * _size));
+    _chirp[i] = RootOfUnity<T>(power, 2 * _size, _isInversed);
+  }
+  _chirpSpectrum.assign(convolutionSize, Value());
+  T scale = T(1) / convolutionSize;
+  for (size_t i = 0; i < _size; ++i) {
+    _chirpSpectrum[i] = std::conj(_chirp[i]) * scale;
+    if (i > 0) {
+      _chirpSpectrum[convolutionSize - i] = _chirpSpectrum[i];
+    }
+  }
+  _convolution->Execute(_chirpSpectrum.data(), _chirpSpectrum.data());
+}
+
+template <typename T> void BasicPlan<T>::RunStages(Value *data) const {
+  for (const auto &stage : _stages) {
+    const Value *twiddles = _twiddles.data() + stage.twiddleOffset;
+    if (stage.radix == 2) {
+      _butterfly(data, _size, stage.span, twiddles);
+      continue;
+    }
+    size_t radix = stage.radix, span = stage.span;
+    for (size_t block = 0; block < _size; block += radix * span) {
+      for (size_t j = 0; j < span; ++j) {
+        Value terms[MAX_RADIX];
+        const Value *w = twiddles + j * (radix - 1);
+        terms[0] = data[block + j];
+        for (size_t q = 1; q < radix; ++q) {
+          terms[q] = Multiply(data[block + q * span + j], w[q - 1]);
+        }
+        for (size_t p = 0; p < radix; ++p) {
+          Value sum = terms[0];
+          for (size_t q = 1, power = p; q < radix; ++q) {
+            sum += Multiply(terms[q], stage.roots[power]);
+            power = power + p < radix ? power + p : power + p - radix;
+          }
+          data[block + p * span + j] = sum;
+        }
+      }
+    }
+  }
+}
+
+// Same stages as RunStages over split real/imaginary planes in which every
+// point holds `lanes` consecutive values, one per frame.
+template <typename T>
+void BasicPlan<T>::RunBatchStages(T *re, T *im, size_t lanes) const {
+  for (const auto &stage : _stages) {
+    const Value *twiddles = _twiddles.data() + stage.twiddleOffset;
+    size_t radix = stage.radix, span = stage.span;
+    for (size_t block = 0; block < _size; block += radix * span) {
+      for (size_t j = 0; j < span; ++j) {
+        const Value *w = twiddles + j * (radix - 1);
+        if (radix == 2) {
+          T wr = w[0].real(), wi = w[0].imag();
+          T *evenRe = re + (block + j) * lanes, *evenIm = im + (block + j) * lanes;
+          T *oddRe = evenRe + span * lanes, *oddIm = evenIm + span * lanes;
+          for (size_t l = 0; l < lanes; ++l) {
+            T pr = wr * oddRe[l] - wi * oddIm[l];
+            T pi = wr * oddIm[l] + wi * oddRe[l];
+            oddRe[l] = evenRe[l] - pr;
+            oddIm[l] = evenIm[l] - pi;
+            evenRe[l] += pr;
+            evenIm[l] += pi;
+          }
+          continue;
+        }
+        T termsRe[MAX_RADIX][BATCH_WIDTH], termsIm[MAX_RADIX][BATCH_WIDTH];
+        for (size_t q = 0; q < radix; ++q) {
+          T wr = q == 0 ? T(1) : w[q - 1].real();
+          T wi = q == 0 ? T(0) : w[q - 1].imag();
+          const T *srcRe = re + (block + q * span + j) * lanes;
+          const T *srcIm = im + (block + q * span + j) * lanes;
+          for (size_t l = 0; l < lanes; ++l) {
+            termsRe[q][l] = wr * srcRe[l] - wi * srcIm[l];
+            termsIm[q][l] = wr * srcIm[l] + wi * srcRe[l];
+          }
+        }
+        for (size_t p = 0; p < radix; ++p) {
+          T *dstRe = re + (block + p * span + j) * lanes;
+          T *dstIm = im + (block + p * span + j) * lanes;
+          std::copy(termsRe[0], termsRe[0] + lanes, dstRe);
+          std::copy(termsIm[0], termsIm[0] + lanes, dstIm);
+          for (size_t q = 1, power = p; q < radix; ++q) {
+            T rr = stage.roots[power].real(), ri = stage.roots[power].imag();
+            for (size_t l = 0; l < lanes; ++l) {
+              dstRe[l] += rr * termsRe[q][l] - ri * termsIm[q][l];
+              dstIm[l] += rr * termsIm[q][l] + ri * termsRe[q][l];
+            }
+            power = power + p < radix ? power + p : power + p - radix;
+          }
+        }
+      }
+    }
+  }
+}
+
+template <typename T>
+void BasicPlan<T>::ExecuteBluestein(const Value *in, Value *out) const {
+  size_t convolutionSize = _convolution->Size();
+  auto &buffer = Scratch<T>(BLUESTEIN_SLOT, convolutionSize);
+  for (size_t i = 0; i < _size; ++i) {
+    buffer[i] = Multiply(in[i], _chirp[i]);
+  }
+  std::fill(buffer.begin() + _size, buffer.begin() + convolutionSize, Value());
+  _convolution->Execute(buffer.data(), buffer.data());
+  // The inverse transform of the product is taken as conj(F(conj(x))).
+  for (size_t i = 0; i < convolutionSize; ++i) {
+    buffer[i] = std::conj(Multiply(buffer[i], _chirpSpectrum[i]));
+  }
+  _convolution->Execute(buffer.data(), buffer.data());
+  for (size_t i = 0; i < _size; ++i) {
+    out[i] = Multiply(std::conj(buffer[i]), _chirp[i]);
+  }
+}
+
+template <typename T>
+void BasicPlan<T>::Execute(const Value *in, Value *out) const {
+  if (_convolution) {
+    ExecuteBluestein(in, out);
+  } else if (in != out) {
+    for (size_t i = 0; i < _size; ++i) {
+      out[i] = in[_permutation[i]];
+    }
+    RunStages(out);
+  } else if (_stages.empty() || _stages.back().radix == 2) {
+    // Bit reversal is an involution and can be applied by swaps.
+    for (size_t i = 0; i < _size; ++i) {
+      if (i < _permutation[i]) {
+        std::swap(out[i], out[_permutation[i]]);
+      }
+    }
+    RunStages(out);
+  } else {
+    auto &buffer = Scratch<T>(PERMUTATION_SLOT, _size);
+    std::copy(in, in + _size, buffer.begin());
+    for (size_t i = 0; i < _size; ++i) {
+      out[i] = buffer[_permutation[i]];
+    }
+    RunStages(out);
+  }
+  if (_isInversed) {
+    T scale = T(1) / _size;
+    for (size_t i = 0; i < _size; ++i) {
+      out[i] *= scale;
+    }
+  }
+}
+
+template <typename T>
+void BasicPlan<T>::Execute(const std::vector<Value> &in,
+                           std::vector<Value> &out) const {
+  if (in.size() != _size) {
+    throw std::invalid_argument("Input size doesn't match the plan!");
+  }
+  out.resize(_size);
+  Execute(in.data(), out.data());
+}
+
+template <typename T>
+void BasicPlan<T>::ExecuteBatch(Value *frames, size_t count) const {
+  if (_convolution || _size > BATCH_SIZE_LIMIT) {
+    for (size_t i = 0; i < count; ++i) {
+      Execute(frames + i * _size, frames + i * _size);
+    }
+    return;
+  }
+  auto &buffer = Scratch<T>(BATCH_SLOT, _size * BATCH_WIDTH);
+  T *re = reinterpret_cast<T *>(buffer.data());
+  T *im = re + _size * BATCH_WIDTH;
+  T scale = _isInversed ? T(1) / _size : T(1);
+  for (size_t first = 0; first < count; first += BATCH_WIDTH) {
+    size_t lanes = std::min(BATCH_WIDTH, count - first);
+    Value *group = frames + first * _size;
+    for (size_t l = 0; l < lanes; ++l) {
+      const Value *frame = group + l * _size;
+      for (size_t i = 0; i < _size; ++i) {
+        re[i * lanes + l] = frame[_permutation[i]].real();
+        im[i * lanes + l] = frame[_permutation[i]].imag();
+      }
+    }
+    RunBatchStages(re, im, lanes);
+    for (size_t l = 0; l < lanes; ++l) {
+      Value *frame = group + l * _size;
+      for (size_t i = 0; i < _size; ++i) {
+        frame[i] = Value(re[i * lanes + l] * scale, im[i * lanes + l] * scale);
+      }
+    }
+  }
+}
+
+template <typename T>
+BasicRealPlan<T>::BasicRealPlan(size_t size)
+    : _size(size),
+      _forward(GetPlan<T>(size % 2 == 0 ? size / 2 : std::max<size_t>(size, 1))),
+      _inverse(
+          GetPlan<T>(size % 2 == 0 ? size / 2 : std::max<size_t>(size, 1), true)) {
+  if (size < 1) {
+    throw std::invalid_argument("Real plan size must be positive!");
+  }
+  if (size % 2 != 0) {
+    return;
+  }
+  size_t half = size / 2;
+  _twiddles.resize(half);
+  for (size_t i = 0; i < half; ++i) {
+    _twiddles[i] = RootOfUnity<T>(i, size, false);
+  }
+}
+
+// Even and odd samples are packed into the real and imaginary parts of a
+// half-size signal, whose spectrum is then split back into the two halves.
+template <typename T>
+void BasicRealPlan<T>::Forward(const T *in, Value *out) const {
+  if (_size % 2 != 0) {
+    ForwardOdd(in, out);
+    return;
+  }
+  size_t half = _size / 2;
+  for (size_t i = 0; i < half; ++i) {
+    out[i] = Value(in[2 * i], in[2 * i + 1]);
+  }
+  _forward->Execute(out, out);
+  Value first = out[0];
+  out[0] = first.real() + first.imag();
+  out[half] = first.real() - first.imag();
+  const Value minusHalfI(0, -0.5);
+  for (size_t k = 1, j = half - 1; k <= j; ++k, --j) {
+    Value zk = out[k], zj = out[j];
+    Value evenK = (zk + std::conj(zj)) * T(0.5);
+    Value oddK = (zk - std::conj(zj)) * minusHalfI;
+    Value evenJ = (zj + std::conj(zk)) * T(0.5);
+    Value oddJ = (zj - std::conj(zk)) * minusHalfI;
+    out[k] = evenK + _twiddles[k] * oddK;
+    out[j] = evenJ + _twiddles[j] * oddJ;
+  }
+}
+
+template <typename T>
+void BasicRealPlan<T>::Inverse(const Value *in, T *out) const {
+  if (_size % 2 != 0) {
+    InverseOdd(in, out);
+    return;
+  }
+  size_t half = _size / 2;
+  auto *packed = reinterpret_cast<Value *>(out);
+  packed[0] = Value(in[0].real() + in[half].real(),
+                    in[0].real() - in[half].real()) *
+              T(0.5);
+  const Value halfI(0, 0.5);
+  for (size_t k = 1, j = half - 1; k <= j; ++k, --j) {
+    Value xk = in[k], xj = in[j];
+    Value evenK = (xk + std::conj(xj)) * T(0.5);
+    Value oddK = (xk - std::conj(xj)) * std::conj(_twiddles[k]);
+    Value evenJ = (xj + std::conj(xk)) * T(0.5);
+    Value oddJ = (xj - std::conj(xk)) * std::conj(_twiddles[j]);
+    packed[k] = evenK + halfI * oddK;
+    packed[j] = evenJ + halfI * oddJ;
+  }
+  _inverse->Execute(packed, packed);
+}
+
+template <typename T>
+void BasicRealPlan<T>::ForwardOdd(const T *in, Value *out) const {
+  auto &buffer = Scratch<T>(REAL_SLOT, _size);
+  std::copy(in, in + _size, buffer.begin());
+  _forward->Execute(buffer.data(), buffer.data());
+  std::copy(buffer.begin(), buffer.begin() + SpectrumSize(), out);
+}
+
+template <typename T>
+void BasicRealPlan<T>::InverseOdd(const Value *in, T *out) const {
+  auto &buffer = Scratch<T>(REAL_SLOT, _size);
+  buffer[0] = in[0];
+  for (size_t k = 1; k < SpectrumSize(); ++k) {
+    buffer[k] = in[k];
+    buffer[_size - k] = std::conj(in[k]);
+  }
+  _inverse->Execute(buffer.data(), buffer.data());
+  for (size_t i = 0; i < _size; ++i) {
+    out[i] = buffer[i].real();
+  }
+}
+
+template <typename T>
+std::shared_ptr<const BasicPlan<T>> GetPlan(size_t size, bool isInversed) {
+  static PlanCache<std::pair<size_t, bool>, BasicPlan<T>> plans(
+      PLAN_CACHE_SIZE);
+  return plans.Get({size, isInversed}, [&] {
+    return std::make_shared<BasicPlan<T>>(size, isInversed);
+  });
+}
+
+template <typename T>
+std::shared_ptr<const BasicRealPlan<T>> GetRealPlan(size_t size) {
+  static PlanCache<size_t, BasicRealPlan<T>> plans(PLAN_CACHE_SIZE);
+  return plans.Get(size,
+                   [&] { return std::make_shared<BasicRealPlan<T>>(size); });
+}
+
+std::vector<Complex> GeneralTransform(std::vector<Complex> data,
+                                      bool isInversed) {
+  Trace::Scope scope(isInversed ? "FFT::InverseTransform" : "FFT::Transform");
+  scope.SetSize(data.size());
+  scope.SetBytes(data.size() * sizeof(Complex));
   if (data.size() < 2) {
     return data;
   }
-  ComplementToPowerOfTwo(data);
-  size_t sz = data.size();
-  auto [evens, odds] = SplitByTwo(data);
-  evens = GeneralTransform(evens);
-  odds = GeneralTransform(odds);
-  long double ang = 2 * M_PI / sz;
-  for (size_t i = 0; i < sz; ++i) {
-    Complex w(std::cos(ang * i), std::sin(ang * i));
-    data[i] = evens[i % (sz / 2)] + w * odds[i % (sz / 2)];
+  if (ThreadCount() > 1 && CanRunInParallel(data.size())) {
+    auto pool = GetThreadPool();
+    GetParallelPlan(data.size(), isInversed)
+        ->Execute(data.data(), data.data(), *pool);
+  } else {
+    GetPlan(data.size(), isInversed)->Execute(data.data(), data.data());
   }
   return data;
 }
 
-std::pair<std::vector<Complex>, std::vector<Complex>>
-SplitByTwo(const std::vector<Complex> &data) {
-  std::vector<Complex> evens, odds;
-  size_t size = data.size();
-  evens.reserve(size / 2);
-  odds.reserve(size / 2);
-  for (size_t i = 0; i < data.size(); i += 2) {
-    evens.push_back(data[i]);
-    odds.push_back(data[i + 1]);
+std::vector<Real> InverseRealTransform(const std::vector<Complex> &spectrum,
+                                       size_t size) {
+  if (spectrum.empty()) {
+    throw std::invalid_argument("Spectrum must not be empty!");
   }
-  return {evens, odds};
+  if (size == 0) {
+    size = 2 * (spectrum.size() - 1);
+  }
+  if (size / 2 + 1 != spectrum.size()) {
+    throw std::invalid_argument("Spectrum doesn't match the signal size!");
+  }
+  Trace::Scope scope("FFT::InverseRealTransform");
+  scope.SetSize(size);
+  auto plan = GetRealPlan(size);
+  std::vector<Real> samples(plan->Size());
+  plan->Inverse(spectrum.data(), samples.data());
+  return samples;
 }
+
+template class BasicPlan<float>;
+template class BasicPlan<double>;
+template class BasicPlan<long double>;
+template class BasicRealPlan<float>;
+template class BasicRealPlan<double>;
+template class BasicRealPlan<long double>;
+
+template std::shared_ptr<const BasicPlan<float>> GetPlan<float>(size_t, bool);
+template std::shared_ptr<const BasicPlan<double>> GetPlan<double>(size_t,
+                                                                  bool);
+template std::shared_ptr<const BasicPlan<long double>>
+GetPlan<long double>(size_t, bool);
+template std::shared_ptr<const BasicRealPlan<float>> GetRealPlan<float>(size_t);
+template std::shared_ptr<const BasicRealPlan<double>>
+GetRealPlan<double>(size_t);
+template std::shared_ptr<const BasicRealPlan<long double>>
+GetRealPlan<long double>(size_t);
 } // namespace FFT
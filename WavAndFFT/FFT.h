@@ -1,30 +1,145 @@
 #pragma once
 
+#include "Butterfly.h"
+#include "Trace.h"
+
 #include <algorithm>
 #include <complex>
+#include <memory>
 #include <vector>
 
 namespace FFT {
-using Complex = std::complex<long double>;
+// `long double` is the reference precision; `float` and `double` plans run
+// vectorised butterflies.
+using Real = long double;
+using Complex = std::complex<Real>;
+
+// Sizes made of the factors 2, 3, 5 and 7 run as mixed-radix decimation in
+// time; any other size is evaluated exactly through Bluestein's chirp-z
+// convolution on a power-of-two plan.
+template <typename T> class BasicPlan {
+public:
+  using Value = std::complex<T>;
+
+  explicit BasicPlan(size_t size, bool isInversed = false);
+
+  size_t Size() const { return _size; }
+  bool IsInversed() const { return _isInversed; }
+
+  // `in` and `out` may point to the same buffer of Size() elements.
+  void Execute(const Value *in, Value *out) const;
+  void Execute(const std::vector<Value> &in, std::vector<Value> &out) const;
+  // Transforms `count` contiguous frames of Size() elements in place. Short
+  // frames are processed in interleaved groups so that every butterfly runs
+  // across the frames of a group; longer ones already vectorise within a
+  // frame and run one by one.
+  void ExecuteBatch(Value *frames, size_t count) const;
+
+private:
+  static constexpr size_t MAX_RADIX = 7;
+  static constexpr size_t BATCH_WIDTH = std::max<size_t>(4, 64 / sizeof(T));
+  static constexpr size_t BATCH_SIZE_LIMIT = 128;
+
+  struct Stage {
+    size_t radix;
+    size_t span;
+    size_t twiddleOffset;
+    Value roots[MAX_RADIX];
+  };
+
+  size_t _size;
+  bool _isInversed;
+  std::vector<Stage> _stages;
+  std::vector<size_t> _permutation;
+  std::vector<Value> _twiddles;
+  ButterflyKernel<T> _butterfly;
+
+  std::unique_ptr<BasicPlan> _convolution;
+  std::vector<Value> _chirp;
+  std::vector<Value> _chirpSpectrum;
+
+  void ComputeStages();
+  void ComputePermutation();
+  void ComputeChirp();
+  void RunStages(Value *data) const;
+  void RunBatchStages(T *re, T *im, size_t lanes) const;
+  void ExecuteBluestein(const Value *in, Value *out) const;
+};
+
+// Transforms `Size()` real samples and keeps only the `Size() / 2 + 1`
+// non-redundant bins of the spectrum. Even sizes run through a half-size
+// complex plan, odd sizes through a full-size one.
+template <typename T> class BasicRealPlan {
+public:
+  using Value = std::complex<T>;
+
+  explicit BasicRealPlan(size_t size);
+
+  size_t Size() const { return _size; }
+  size_t SpectrumSize() const { return _size / 2 + 1; }
 
-void ComplementToPowerOfTwo(std::vector<Complex> &data);
-std::pair<std::vector<Complex>, std::vector<Complex>>
-SplitByTwo(const std::vector<Complex> &data);
+  // `out` must hold SpectrumSize() elements.
+  void Forward(const T *in, Value *out) const;
+  // `out` must hold Size() elements; the result is scaled by 1 / Size().
+  void Inverse(const Value *in, T *out) const;
 
-std::vector<Complex> GeneralTransform(std::vector<Complex> data);
+private:
+  size_t _size;
+  std::shared_ptr<const BasicPlan<T>> _forward;
+  std::shared_ptr<const BasicPlan<T>> _inverse;
+  std::vector<Value> _twiddles;
 
+  void ForwardOdd(const T *in, Value *out) const;
+  void InverseOdd(const Value *in, T *out) const;
+};
+
+using Plan = BasicPlan<Real>;
+using RealPlan = BasicRealPlan<Real>;
+
+// Plans are built once per (size, direction) and shared between threads. Only
+// the most recently used ones stay cached; callers keep theirs alive.
+template <typename T = Real>
+std::shared_ptr<const BasicPlan<T>> GetPlan(size_t size,
+                                            bool isInversed = false);
+template <typename T = Real>
+std::shared_ptr<const BasicRealPlan<T>> GetRealPlan(size_t size);
+
+std::vector<Complex> GeneralTransform(std::vector<Complex> data,
+                                      bool isInversed = false);
+
+// Large transforms run on the FFT thread pool once SetThreadCount() allows it.
 template <typename T>
 std::vector<Complex> Transform(const std::vector<T> &data,
                                bool isInversed = false) {
-  std::vector<Complex> complexData(data.begin(), data.end());
-  complexData = GeneralTransform(complexData);
-  if (isInversed) {
-    for (auto &value : complexData) {
-      value /= complexData.size();
-    }
-    std::reverse(complexData.begin() + 1, complexData.end());
-  }
-  return complexData;
+  return GeneralTransform({data.begin(), data.end()}, isInversed);
+}
+
+template <typename T>
+void TransformBatch(std::complex<T> *frames, size_t frameSize, size_t count,
+                    bool isInversed = false) {
+  GetPlan<T>(frameSize, isInversed)->ExecuteBatch(frames, count);
+}
+
+template <typename T>
+std::vector<Complex> RealTransform(const std::vector<T> &data) {
+  Trace::Scope scope("FFT::RealTransform");
+  scope.SetSize(data.size());
+  std::vector<Real> samples(data.begin(), data.end());
+  auto plan = GetRealPlan(samples.size());
+  std::vector<Complex> spectrum(plan->SpectrumSize());
+  plan->Forward(samples.data(), spectrum.data());
+  return spectrum;
 }
 
-} // namespace FFT
\ No newline at end of file
+// `size` defaults to the even length 2 * (spectrum.size() - 1).
+std::vector<Real> InverseRealTransform(const std::vector<Complex> &spectrum,
+                                       size_t size = 0);
+
+extern template class BasicPlan<float>;
+extern template class BasicPlan<double>;
+extern template class BasicPlan<long double>;
+extern template class BasicRealPlan<float>;
+extern template class BasicRealPlan<double>;
+extern template class BasicRealPlan<long double>;
+
+} // namespace FFT
@@ -0,0 +1,186 @@
+#include "FilterDesign.h"
+#include "FFT.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <tuple>
+
+namespace Dsp {
+namespace {
+double ParseNumber(const std::string &text, const std::string &spec) {
+  size_t parsed = 0;
+  double value = 0;
+  try {
+    value = std::stod(text, &parsed);
+  } catch (const std::exception &) {
+    parsed = 0;
+  }
+  if (parsed == 0 || parsed != text.size() || !std::isfinite(value) ||
+      value < 0) {
+    throw std::invalid_argument("Malformed filter spec: " + spec);
+  }
+  return value;
+}
+
+// Digits only, so signs, fractions and exponents are all refused.
+size_t ParseCount(const std::string &text, const std::string &spec) {
+  bool isDigits = !text.empty() && text.find_first_not_of("0123456789") ==
+                                       std::string::npos;
+  size_t value = 0;
+  try {
+    value = isDigits ? std::stoul(text) : 0;
+  } catch (const std::exception &) {
+    value = 0;
+  }
+  if (value == 0) {
+    throw std::invalid_argument("Filter taps must be a positive integer: " +
+                                spec);
+  }
+  return value;
+}
+
+void ParseRange(const std::string &text, const std::string &spec,
+                FilterSpec &result) {
+  auto dash = text.find('-');
+  if (dash == std::string::npos) {
+    throw std::invalid_argument("Filter needs a low-high range: " + spec);
+  }
+  result.low = ParseNumber(text.substr(0, dash), spec);
+  result.high = ParseNumber(text.substr(dash + 1), spec);
+  if (result.low >= result.high) {
+    throw std::invalid_argument("Filter range is empty: " + spec);
+  }
+}
+
+// Impulse response of an ideal low-pass with `cutoff` as a fraction of the
+// sample rate, centered in `taps` points.
+std::vector<double> LowPass(double cutoff, size_t taps) {
+  std::vector<double> response(taps);
+  double middle = (taps - 1) / 2.;
+  for (size_t i = 0; i < taps; ++i) {
+    double t = i - middle;
+    response[i] = t == 0 ? 2 * cutoff
+                         : std::sin(2 * M_PI * cutoff * t) / (M_PI * t);
+  }
+  return response;
+}
+
+using CacheKey =
+    std::tuple<FilterType, double, double, double, size_t, size_t, uint32_t>;
+} // namespace
+
+FilterSpec ParseFilterSpec(const std::string &text) {
+  FilterSpec spec;
+  auto colon = text.find(':');
+  if (colon == std::string::npos) {
+    throw std::invalid_argument("Malformed filter spec: " + text);
+  }
+  std::string type = text.substr(0, colon);
+  std::string parameters = text.substr(colon + 1);
+  auto comma = parameters.find(',');
+  if (comma != std::string::npos) {
+    std::string option = parameters.substr(comma + 1);
+    parameters.resize(comma);
+    if (option.rfind("taps=", 0) != 0) {
+      throw std::invalid_argument("Unknown filter option: " + text);
+    }
+    spec.taps = ParseCount(option.substr(5), text);
+  }
+  if (type == "portion") {
+    spec.type = FilterType::PORTION;
+    spec.portion = ParseNumber(parameters, text);
+    if (spec.portion > 1) {
+      throw std::invalid_argument("Portion must be in [0, 1]: " + text);
+    }
+  } else if (type == "lowpass") {
+    spec.type = FilterType::LOW_PASS;
+    spec.high = ParseNumber(parameters, text);
+  } else if (type == "highpass") {
+    spec.type = FilterType::HIGH_PASS;
+    spec.low = ParseNumber(parameters, text);
+  } else if (type == "bandpass") {
+    spec.type = FilterType::BAND_PASS;
+    ParseRange(parameters, text, spec);
+  } else if (type == "notch") {
+    spec.type = FilterType::NOTCH;
+    ParseRange(parameters, text, spec);
+  } else {
+    throw std::invalid_argument("Unknown filter type: " + text);
+  }
+  return spec;
+}
+
+// High-pass, band-pass and notch responses are built from low-pass
+// prototypes by spectral inversion and subtraction.
+Response DesignResponse(const FilterSpec &spec, uint32_t sampleRate) {
+  static std::mutex mutex;
+  static std::map<CacheKey, Response> cache;
+  CacheKey key{spec.type,  spec.portion,   spec.low,  spec.high,
+               spec.taps, spec.frameSize, sampleRate};
+  std::lock_guard<std::mutex> lock(mutex);
+  auto &response = cache[key];
+  if (response) {
+    return response;
+  }
+  if (sampleRate == 0 || spec.frameSize < 4 || spec.frameSize % 2 != 0) {
+    throw std::invalid_argument("Filter can't be designed for this format!");
+  }
+
+  // An odd length puts the center on a sample; the default keeps the
+  // impulse response well inside one frame.
+  size_t taps = spec.taps ? spec.taps : spec.frameSize / 4;
+  taps = std::clamp<size_t>(taps | 1u, 3, spec.frameSize - 1);
+  double nyquist = sampleRate / 2.;
+  auto fraction = [&](double hz) { return std::min(hz, nyquist) / sampleRate; };
+
+  std::vector<double> impulse;
+  switch (spec.type) {
+  case FilterType::PORTION:
+    impulse = LowPass(fraction((1 - spec.portion) * nyquist), taps);
+    break;
+  case FilterType::LOW_PASS:
+    impulse = LowPass(fraction(spec.high), taps);
+    break;
+  case FilterType::HIGH_PASS:
+  case FilterType::NOTCH: {
+    // A high-pass is a notch that rejects everything below its cutoff.
+    bool isNotch = spec.type == FilterType::NOTCH;
+    double low = isNotch ? fraction(spec.low) : 0;
+    double high = isNotch ? fraction(spec.high) : fraction(spec.low);
+    impulse = LowPass(low, taps);
+    auto upper = LowPass(high, taps);
+    for (size_t i = 0; i < taps; ++i) {
+      impulse[i] -= upper[i];
+    }
+    impulse[taps / 2] += 1;
+    break;
+  }
+  case FilterType::BAND_PASS: {
+    impulse = LowPass(fraction(spec.high), taps);
+    auto lower = LowPass(fraction(spec.low), taps);
+    for (size_t i = 0; i < taps; ++i) {
+      impulse[i] -= lower[i];
+    }
+    break;
+  }
+  }
+  for (size_t i = 0; i < taps; ++i) {
+    impulse[i] *= 0.42 - 0.5 * std::cos(2 * M_PI * i / (taps - 1)) +
+                  0.08 * std::cos(4 * M_PI * i / (taps - 1));
+  }
+
+  auto plan = FFT::GetRealPlan<double>(spec.frameSize);
+  impulse.resize(spec.frameSize);
+  std::vector<std::complex<double>> spectrum(plan->SpectrumSize());
+  plan->Forward(impulse.data(), spectrum.data());
+  auto gains = std::make_shared<std::vector<double>>(spectrum.size());
+  for (size_t i = 0; i < spectrum.size(); ++i) {
+    (*gains)[i] = std::abs(spectrum[i]);
+  }
+  response = gains;
+  return response;
+}
+} // namespace Dsp
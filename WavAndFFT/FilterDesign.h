@@ -0,0 +1,38 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Dsp {
+enum class FilterType { PORTION, LOW_PASS, HIGH_PASS, BAND_PASS, NOTCH };
+
+// Describes a frequency-domain filter. Specs are written as
+// "<type>:<parameters>":
+//   lowpass:3000        passes everything below 3000 Hz
+//   highpass:300        passes everything above 300 Hz
+//   bandpass:300-3400   passes 300..3400 Hz
+//   notch:45-55         rejects 45..55 Hz
+//   portion:0.8         low-pass that rejects the upper 80% of the band
+// An optional ",taps=<n>" sets the length of the prototype FIR and with it
+// the transition width.
+struct FilterSpec {
+  FilterType type = FilterType::PORTION;
+  double portion = 0.8;
+  double low = 0;
+  double high = 0;
+  size_t taps = 0;
+  size_t frameSize = 4096;
+};
+
+// Throws std::invalid_argument for malformed specs.
+FilterSpec ParseFilterSpec(const std::string &text);
+
+using Response = std::shared_ptr<const std::vector<double>>;
+
+// Real, zero-phase gains for the frameSize / 2 + 1 bins of a spectrum,
+// taken from the magnitude response of a Blackman-windowed sinc design.
+// Responses are cached per (spec, sample rate), so repeated runs over a
+// corpus design every filter once.
+Response DesignResponse(const FilterSpec &spec, uint32_t sampleRate);
+} // namespace Dsp
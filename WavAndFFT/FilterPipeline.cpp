@@ -0,0 +1,114 @@
+#include "FilterPipeline.h"
+#include "SampleView.h"
+#include "Trace.h"
+#include "WavWriter.h"
+
+#include <chrono>
+#include <stdexcept>
+
+namespace Dsp {
+FilterPipeline::FilterPipeline(const FilterSpec &spec, uint32_t sampleRate,
+                               size_t threads)
+    : _spec(spec), _sampleRate(sampleRate),
+      _threads(std::max<size_t>(threads, 1)) {}
+
+void FilterPipeline::ProcessChannel(Channel &channel, size_t frames,
+                                    bool isLast) {
+  auto *samples = &channel.samples;
+  if (channel.resampler) {
+    channel.resampled.clear();
+    channel.resampler->Process(samples->data(), frames, channel.resampled);
+    if (isLast) {
+      channel.resampler->Flush(channel.resampled);
+    }
+    samples = &channel.resampled;
+    frames = samples->size();
+  }
+  channel.filtered.clear();
+  channel.filter.Process(samples->data(), frames, channel.filtered);
+  if (isLast) {
+    channel.filter.Flush(channel.filtered);
+  }
+}
+
+PipelineStats FilterPipeline::Run(Wav::File &input,
+                                  const std::string &outputPath) {
+  Trace::Scope scope("Dsp::FilterPipeline");
+  auto start = std::chrono::steady_clock::now();
+  const auto &header = input.GetHeader();
+  Wav::Header outputHeader = header;
+  if (_sampleRate != 0) {
+    outputHeader.sampleRate = _sampleRate;
+    outputHeader.byteRate = _sampleRate * header.blockAlign;
+  }
+  bool isResampling = outputHeader.sampleRate != header.sampleRate;
+  auto gains = DesignResponse(_spec, outputHeader.sampleRate);
+  while (_channels.size() < header.numChannels) {
+    _channels.push_back({StftFilter(_spec.frameSize, gains), {}, {}, {}, {}});
+  }
+  for (auto &channel : _channels) {
+    channel.filter.SetGains(gains);
+    channel.filter.Reset();
+    channel.resampler.reset();
+    if (isResampling) {
+      channel.resampler.emplace(header.sampleRate, outputHeader.sampleRate);
+    }
+  }
+  size_t threads = std::min<size_t>(_threads, header.numChannels);
+  if (threads > 1 && (!_pool || _pool->Size() + 1 < threads)) {
+    // The calling thread takes channels too.
+    _pool = std::make_unique<ThreadPool>(threads - 1);
+  }
+  _planes.resize(header.numChannels);
+  _filteredPlanes.resize(header.numChannels);
+
+  Wav::Writer output(outputPath, outputHeader);
+  PipelineStats stats;
+  auto filterBlock = [&](bool isLast) {
+    size_t frames = _block.size() / header.blockAlign;
+    for (uint16_t c = 0; c < header.numChannels; ++c) {
+      _channels[c].samples.resize(frames);
+      _planes[c] = _channels[c].samples.data();
+    }
+    Wav::Deinterleave(_block.data(), frames, header, _planes.data());
+    auto processChannels = [&](size_t begin, size_t end) {
+      for (size_t c = begin; c < end; ++c) {
+        ProcessChannel(_channels[c], frames, isLast);
+      }
+    };
+    if (threads > 1) {
+      _pool->ParallelFor(header.numChannels, processChannels);
+    } else {
+      processChannels(0, header.numChannels);
+    }
+    // Every channel went through the same stages, so they all produced the
+    // same number of samples.
+    size_t produced = _channels[0].filtered.size();
+    for (uint16_t c = 0; c < header.numChannels; ++c) {
+      _filteredPlanes[c] = _channels[c].filtered.data();
+    }
+    _result.resize(produced * header.blockAlign);
+    Wav::Interleave(_filteredPlanes.data(), produced, header, _result.data());
+    output.Write(_result);
+    stats.frames += frames;
+    stats.bytes += _block.size();
+  };
+  while (input.ReadBlock(_block, BLOCK_FRAMES * header.blockAlign) > 0) {
+    filterBlock(false);
+  }
+  filterBlock(true);
+  output.Close();
+  scope.SetBytes(stats.bytes);
+  stats.seconds = std::chrono::duration<double>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+  return stats;
+}
+
+PipelineStats FilterPipeline::Run(const std::string &inputPath,
+                                  const std::string &outputPath) {
+  Wav::File input;
+  input.Open(inputPath);
+  return Run(input, outputPath);
+}
+} // namespace Dsp
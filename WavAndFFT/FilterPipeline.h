@@ -0,0 +1,62 @@
+#pragma once
+
+#include "FilterDesign.h"
+#include "Resampler.h"
+#include "StftFilter.h"
+#include "ThreadPool.h"
+#include "WavReader.h"
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace Dsp {
+struct PipelineStats {
+  uint64_t frames = 0;
+  uint64_t bytes = 0;
+  double seconds = 0;
+};
+
+// Filters WAV files block by block with the response designed for their
+// sample rate. Every block is split into one planar buffer per channel, and
+// the channels are resampled (with a target sample rate) and filtered on
+// their own threads before they are interleaved again. Buffers and
+// per-channel filters are kept between runs, so a pipeline reused for many
+// files only allocates when a file has more channels than any before it.
+class FilterPipeline {
+public:
+  static const size_t BLOCK_FRAMES = 1lu << 14lu;
+
+  // A zero `sampleRate` keeps the rate of every input. Up to `threads`
+  // channels are processed at once.
+  explicit FilterPipeline(const FilterSpec &spec, uint32_t sampleRate = 0,
+                          size_t threads = 1);
+
+  // `input` must have been opened with Wav::File::Open.
+  PipelineStats Run(Wav::File &input, const std::string &outputPath);
+  PipelineStats Run(const std::string &inputPath,
+                    const std::string &outputPath);
+
+private:
+  struct Channel {
+    StftFilter filter;
+    std::optional<Resampler> resampler;
+    std::vector<double> samples;
+    std::vector<double> resampled;
+    std::vector<double> filtered;
+  };
+
+  FilterSpec _spec;
+  uint32_t _sampleRate;
+  size_t _threads;
+  std::unique_ptr<ThreadPool> _pool;
+  std::vector<Channel> _channels;
+  std::vector<Wav::File::Byte> _block;
+  std::vector<Wav::File::Byte> _result;
+  std::vector<double *> _planes;
+  std::vector<const double *> _filteredPlanes;
+
+  void ProcessChannel(Channel &channel, size_t frames, bool isLast);
+};
+} // namespace Dsp
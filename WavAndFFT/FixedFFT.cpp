@@ -0,0 +1,116 @@
+#include "FixedFFT.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+namespace FFT {
+namespace {
+template <typename T> struct FixedTraits;
+
+template <> struct FixedTraits<int16_t> {
+  using Wide = int32_t;
+  static constexpr int FRACTION_BITS = 15;
+};
+
+template <> struct FixedTraits<int32_t> {
+  using Wide = int64_t;
+  static constexpr int FRACTION_BITS = 31;
+};
+
+// A radix-2 butterfly grows a component by at most 1 + sqrt(2), so values
+// below 2 / 5 of full scale are safe for one more stage, and values below
+// 4 / 5 once they are halved.
+template <typename T> constexpr T StageLimit() {
+  return static_cast<T>(
+      (typename FixedTraits<T>::Wide(1) << FixedTraits<T>::FRACTION_BITS) * 2 /
+      5);
+}
+} // namespace
+
+template <typename T>
+FixedPlan<T>::FixedPlan(size_t size, bool isInversed)
+    : _size(size), _isInversed(isInversed) {
+  if (size == 0 || (size & (size - 1)) != 0) {
+    throw std::invalid_argument("Fixed-point plan size must be a power of two!");
+  }
+  const long double one =
+      (typename FixedTraits<T>::Wide(1) << FixedTraits<T>::FRACTION_BITS) - 1;
+  for (size_t span = 1; span < _size; span *= 2) {
+    _stages.push_back({span, _twiddles.size()});
+    for (size_t j = 0; j < span; ++j) {
+      long double ang = (isInversed ? -1 : 1) * M_PIl * j / span;
+      _twiddles.push_back({static_cast<T>(std::lround(std::cos(ang) * one)),
+                           static_cast<T>(std::lround(std::sin(ang) * one))});
+    }
+  }
+  _permutation.resize(_size);
+  for (size_t i = 1; i < _size; ++i) {
+    _permutation[i] = (_permutation[i / 2] / 2) | (i % 2 ? _size / 2 : 0);
+  }
+}
+
+template <typename T> int FixedPlan<T>::Execute(Value *data) const {
+  using Wide = typename FixedTraits<T>::Wide;
+  const int bits = FixedTraits<T>::FRACTION_BITS;
+  const Wide round = Wide(1) << (bits - 1);
+
+  for (size_t i = 0; i < _size; ++i) {
+    if (i < _permutation[i]) {
+      std::swap(data[i], data[_permutation[i]]);
+    }
+  }
+  int exponent = 0;
+  for (const auto &stage : _stages) {
+    Wide peak = 0;
+    for (size_t i = 0; i < _size; ++i) {
+      peak = std::max({peak, std::abs(Wide(data[i].real)),
+                       std::abs(Wide(data[i].imag))});
+    }
+    int shift = peak < StageLimit<T>() ? 0 : peak / 2 < StageLimit<T>() ? 1 : 2;
+    Wide half = shift > 0 ? Wide(1) << (shift - 1) : 0;
+    exponent += shift;
+
+    const Value *twiddles = _twiddles.data() + stage.twiddleOffset;
+    size_t span = stage.span;
+    for (size_t block = 0; block < _size; block += 2 * span) {
+      Value *low = data + block, *high = low + span;
+      for (size_t j = 0; j < span; ++j) {
+        Wide wr = twiddles[j].real, wi = twiddles[j].imag;
+        Wide vr = (high[j].real * wr - high[j].imag * wi + round) >> bits;
+        Wide vi = (high[j].real * wi + high[j].imag * wr + round) >> bits;
+        Wide ur = low[j].real, ui = low[j].imag;
+        low[j] = {static_cast<T>((ur + vr + half) >> shift),
+                  static_cast<T>((ui + vi + half) >> shift)};
+        high[j] = {static_cast<T>((ur - vr + half) >> shift),
+                   static_cast<T>((ui - vi + half) >> shift)};
+      }
+    }
+  }
+  if (_isInversed) {
+    exponent -= _stages.size();
+  }
+  return exponent;
+}
+
+template <typename T>
+const FixedPlan<T> &GetFixedPlan(size_t size, bool isInversed) {
+  static std::mutex mutex;
+  static std::map<std::pair<size_t, bool>, std::unique_ptr<FixedPlan<T>>>
+      plans;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto &plan = plans[{size, isInversed}];
+  if (!plan) {
+    plan = std::make_unique<FixedPlan<T>>(size, isInversed);
+  }
+  return *plan;
+}
+
+template class FixedPlan<int16_t>;
+template class FixedPlan<int32_t>;
+template const FixedPlan<int16_t> &GetFixedPlan<int16_t>(size_t, bool);
+template const FixedPlan<int32_t> &GetFixedPlan<int32_t>(size_t, bool);
+} // namespace FFT
@@ -0,0 +1,216 @@
+#include "NTT.h"
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <tuple>
+
+namespace FFT {
+namespace {
+const uint32_t PRIMITIVE_ROOT = 3;
+
+// Modular inverse by Newton iteration: every step doubles the number of
+// correct low bits.
+uint32_t InverseModulo2To32(uint32_t value) {
+  uint32_t inverse = value;
+  for (int i = 0; i < 5; ++i) {
+    inverse *= 2 - value * inverse;
+  }
+  return inverse;
+}
+
+uint32_t MultiplyModulo(uint64_t a, uint64_t b, uint32_t modulus) {
+  return static_cast<uint32_t>(a * b % modulus);
+}
+
+uint32_t InverseModulo(uint32_t value, uint32_t modulus) {
+  uint32_t result = 1;
+  for (uint32_t exponent = modulus - 2; exponent > 0; exponent >>= 1u) {
+    if (exponent & 1u) {
+      result = MultiplyModulo(result, value, modulus);
+    }
+    value = MultiplyModulo(value, value, modulus);
+  }
+  return result;
+}
+} // namespace
+
+Montgomery::Montgomery(uint32_t modulus)
+    : _modulus(modulus),
+      _negativeInverse(0u - InverseModulo2To32(modulus)) {
+  if (modulus % 2 == 0 || modulus >= (1u << 30u)) {
+    throw std::invalid_argument("Modulus must be odd and below 2^30!");
+  }
+  _r2 = static_cast<uint32_t>(((unsigned __int128)1 << 64u) % modulus);
+}
+
+uint32_t Montgomery::Power(uint32_t base, uint64_t exponent) const {
+  uint32_t result = ToMontgomery(1);
+  base = ToMontgomery(base);
+  for (; exponent > 0; exponent >>= 1u) {
+    if (exponent & 1u) {
+      result = Multiply(result, base);
+    }
+    base = Multiply(base, base);
+  }
+  return Reduce(result);
+}
+
+NttPlan::NttPlan(size_t size, uint32_t modulus, bool isInversed)
+    : _size(size), _isInversed(isInversed), _arithmetic(modulus) {
+  if (size == 0 || (size & (size - 1)) != 0) {
+    throw std::invalid_argument("NTT size must be a power of two!");
+  }
+  if ((modulus - 1) % size != 0) {
+    throw std::invalid_argument("NTT size is too big for the modulus!");
+  }
+  for (size_t span = 1; span < _size; span *= 2) {
+    uint32_t root = _arithmetic.Power(PRIMITIVE_ROOT, (modulus - 1) / (2 * span));
+    if (_isInversed) {
+      root = InverseModulo(root, modulus);
+    }
+    _stages.push_back({span, _twiddles.size()});
+    uint32_t twiddle = 1;
+    for (size_t j = 0; j < span; ++j) {
+      _twiddles.push_back(_arithmetic.ToMontgomery(twiddle));
+      twiddle = MultiplyModulo(twiddle, root, modulus);
+    }
+  }
+
+  _permutation.resize(_size);
+  for (size_t i = 1; i < _size; ++i) {
+    _permutation[i] = (_permutation[i / 2] / 2) | (i % 2 ? _size / 2 : 0);
+  }
+  _scale = _arithmetic.ToMontgomery(
+      _isInversed ? InverseModulo(_size % modulus, modulus) : 1);
+}
+
+void NttPlan::Execute(uint32_t *data) const {
+  for (size_t i = 0; i < _size; ++i) {
+    if (i < _permutation[i]) {
+      std::swap(data[i], data[_permutation[i]]);
+    }
+  }
+  uint32_t modulus = Modulus();
+  for (const auto &stage : _stages) {
+    const uint32_t *twiddles = _twiddles.data() + stage.twiddleOffset;
+    size_t span = stage.span;
+    for (size_t block = 0; block < _size; block += 2 * span) {
+      uint32_t *low = data + block, *high = low + span;
+      for (size_t j = 0; j < span; ++j) {
+        uint32_t u = low[j];
+        uint32_t v = _arithmetic.Multiply(high[j], twiddles[j]);
+        low[j] = u + v >= modulus ? u + v - modulus : u + v;
+        high[j] = u >= v ? u - v : u + modulus - v;
+      }
+    }
+  }
+  if (_isInversed) {
+    for (size_t i = 0; i < _size; ++i) {
+      data[i] = _arithmetic.Multiply(data[i], _scale);
+    }
+  }
+}
+
+const NttPlan &GetNttPlan(size_t size, uint32_t modulus, bool isInversed) {
+  static std::mutex mutex;
+  static std::map<std::tuple<size_t, uint32_t, bool>, std::unique_ptr<NttPlan>>
+      plans;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto &plan = plans[{size, modulus, isInversed}];
+  if (!plan) {
+    plan = std::make_unique<NttPlan>(size, modulus, isInversed);
+  }
+  return *plan;
+}
+
+std::vector<uint32_t> ModularConvolution(const std::vector<uint32_t> &a,
+                                         const std::vector<uint32_t> &b,
+                                         uint32_t modulus) {
+  if (a.empty() || b.empty()) {
+    return {};
+  }
+  size_t resultSize = a.size() + b.size() - 1;
+  size_t size = 1;
+  while (size < resultSize) {
+    size <<= 1lu;
+  }
+  const auto &forward = GetNttPlan(size, modulus);
+  const auto &inverse = GetNttPlan(size, modulus, true);
+  Montgomery arithmetic(modulus);
+
+  std::vector<uint32_t> left(size, 0), right(size, 0);
+  for (size_t i = 0; i < a.size(); ++i) {
+    left[i] = a[i] % modulus;
+  }
+  for (size_t i = 0; i < b.size(); ++i) {
+    right[i] = arithmetic.ToMontgomery(b[i] % modulus);
+  }
+  // The transform is linear, so `right` can stay in Montgomery form and the
+  // pointwise product comes out in the normal domain.
+  forward.Execute(left.data());
+  forward.Execute(right.data());
+  for (size_t i = 0; i < size; ++i) {
+    left[i] = arithmetic.Multiply(left[i], right[i]);
+  }
+  inverse.Execute(left.data());
+  left.resize(resultSize);
+  return left;
+}
+
+std::vector<uint64_t> ExactConvolution(const std::vector<uint64_t> &a,
+                                       const std::vector<uint64_t> &b) {
+  if (a.empty() || b.empty()) {
+    return {};
+  }
+  using Wide = unsigned __int128;
+  Wide bound = Wide(*std::max_element(a.begin(), a.end())) *
+               *std::max_element(b.begin(), b.end());
+  if (bound > UINT64_MAX / std::min(a.size(), b.size())) {
+    throw std::invalid_argument("Convolution may not fit 64 bits!");
+  }
+  bound *= std::min(a.size(), b.size());
+
+  size_t primeCount = 1;
+  for (Wide product = NTT_PRIMES[0]; product <= bound; ++primeCount) {
+    product *= NTT_PRIMES[primeCount];
+  }
+  std::vector<std::vector<uint32_t>> residues;
+  for (size_t p = 0; p < primeCount; ++p) {
+    std::vector<uint32_t> left(a.size()), right(b.size());
+    for (size_t i = 0; i < a.size(); ++i) {
+      left[i] = a[i] % NTT_PRIMES[p];
+    }
+    for (size_t i = 0; i < b.size(); ++i) {
+      right[i] = b[i] % NTT_PRIMES[p];
+    }
+    residues.push_back(ModularConvolution(left, right, NTT_PRIMES[p]));
+  }
+
+  // Garner: x = r0 + p0 * (t1 + p1 * t2) with every t reduced modulo the
+  // next prime.
+  uint32_t p0 = NTT_PRIMES[0], p1 = NTT_PRIMES[1], p2 = NTT_PRIMES[2];
+  uint32_t p0InverseP1 = InverseModulo(p0 % p1, p1);
+  uint32_t p0p1InverseP2 = InverseModulo(MultiplyModulo(p0, p1, p2), p2);
+  std::vector<uint64_t> result(residues[0].size());
+  for (size_t i = 0; i < result.size(); ++i) {
+    uint64_t r0 = residues[0][i];
+    Wide value = r0;
+    if (primeCount > 1) {
+      uint32_t t1 = MultiplyModulo(residues[1][i] + p1 - r0 % p1, p0InverseP1,
+                                   p1);
+      value += Wide(p0) * t1;
+      if (primeCount > 2) {
+        uint32_t x01 = static_cast<uint32_t>(value % p2);
+        uint32_t t2 = MultiplyModulo(residues[2][i] + p2 - x01,
+                                     p0p1InverseP2, p2);
+        value += Wide(p0) * p1 * t2;
+      }
+    }
+    result[i] = static_cast<uint64_t>(value);
+  }
+  return result;
+}
+} // namespace FFT
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace FFT {
+// Primes of the form c * 2^k + 1 with primitive root 3; the exponent bounds
+// the transform size for each of them.
+constexpr uint32_t NTT_PRIMES[] = {998244353, 167772161, 469762049};
+
+// Arithmetic modulo an odd modulus below 2^30 in Montgomery form with
+// R = 2^32. Multiply(a, ToMontgomery(b)) yields a * b in the normal domain,
+// which lets constants live in Montgomery form and data stay as it is.
+class Montgomery {
+public:
+  explicit Montgomery(uint32_t modulus);
+
+  uint32_t Modulus() const { return _modulus; }
+
+  uint32_t Reduce(uint64_t value) const {
+    uint32_t m = static_cast<uint32_t>(value) * _negativeInverse;
+    uint32_t t = (value + uint64_t(m) * _modulus) >> 32u;
+    return t >= _modulus ? t - _modulus : t;
+  }
+  uint32_t Multiply(uint32_t a, uint32_t b) const {
+    return Reduce(uint64_t(a) * b);
+  }
+  uint32_t ToMontgomery(uint32_t value) const {
+    return Reduce(uint64_t(value) * _r2);
+  }
+  uint32_t Power(uint32_t base, uint64_t exponent) const;
+
+private:
+  uint32_t _modulus;
+  uint32_t _negativeInverse;
+  uint32_t _r2;
+};
+
+// Radix-2 decimation in time over Z / p with the stage and twiddle layout
+// of BasicPlan. The inverse is scaled by 1 / Size() like the complex one.
+class NttPlan {
+public:
+  NttPlan(size_t size, uint32_t modulus, bool isInversed = false);
+
+  size_t Size() const { return _size; }
+  uint32_t Modulus() const { return _arithmetic.Modulus(); }
+  bool IsInversed() const { return _isInversed; }
+
+  // Transforms Size() residues in [0, Modulus()) in place.
+  void Execute(uint32_t *data) const;
+
+private:
+  struct Stage {
+    size_t span;
+    size_t twiddleOffset;
+  };
+
+  size_t _size;
+  bool _isInversed;
+  Montgomery _arithmetic;
+  std::vector<Stage> _stages;
+  std::vector<uint32_t> _permutation;
+  // In Montgomery form.
+  std::vector<uint32_t> _twiddles;
+  uint32_t _scale;
+};
+
+// Plans are built once per (size, modulus, direction) and shared between
+// threads.
+const NttPlan &GetNttPlan(size_t size, uint32_t modulus,
+                          bool isInversed = false);
+
+// Linear convolution modulo one of NTT_PRIMES; inputs are reduced first.
+std::vector<uint32_t> ModularConvolution(const std::vector<uint32_t> &a,
+                                         const std::vector<uint32_t> &b,
+                                         uint32_t modulus);
+
+// Exact convolution of non-negative integers. As many primes as the bound
+// min(|a|, |b|) * max(a) * max(b) needs are combined with Garner's CRT;
+// results that can exceed 2^64 are rejected.
+std::vector<uint64_t> ExactConvolution(const std::vector<uint64_t> &a,
+                                       const std::vector<uint64_t> &b);
+} // namespace FFT
@@ -0,0 +1,151 @@
+#include "ParallelFFT.h"
+
+#include "PlanCache.h"
+
+#include <cmath>
+#include <mutex>
+#include <stdexcept>
+
+namespace FFT {
+namespace {
+const size_t TRANSPOSE_TILE = 32;
+
+// The split closest to a square keeps both sub-transforms cache sized.
+size_t ChooseRows(size_t size) {
+  size_t rows = static_cast<size_t>(std::sqrt(static_cast<double>(size)));
+  while (rows > 1 && size % rows != 0) {
+    --rows;
+  }
+  return rows;
+}
+
+// Writes the transpose of the `rows` x `columns` matrix `in` to `out`.
+template <typename T>
+void Transpose(const std::complex<T> *in, std::complex<T> *out, size_t rows,
+               size_t columns, ThreadPool &pool) {
+  size_t tiles = (rows + TRANSPOSE_TILE - 1) / TRANSPOSE_TILE;
+  pool.ParallelFor(tiles, [=](size_t begin, size_t end) {
+    for (size_t r0 = begin * TRANSPOSE_TILE;
+         r0 < std::min(rows, end * TRANSPOSE_TILE); r0 += TRANSPOSE_TILE) {
+      size_t r1 = std::min(rows, r0 + TRANSPOSE_TILE);
+      for (size_t c0 = 0; c0 < columns; c0 += TRANSPOSE_TILE) {
+        size_t c1 = std::min(columns, c0 + TRANSPOSE_TILE);
+        for (size_t r = r0; r < r1; ++r) {
+          for (size_t c = c0; c < c1; ++c) {
+            out[c * rows + r] = in[r * columns + c];
+          }
+        }
+      }
+    }
+  });
+}
+
+std::mutex poolMutex;
+std::shared_ptr<ThreadPool> pool;
+size_t threadCount = 1;
+} // namespace
+
+bool CanRunInParallel(size_t size) {
+  return size >= PARALLEL_THRESHOLD && ChooseRows(size) > 1;
+}
+
+template <typename T>
+BasicParallelPlan<T>::BasicParallelPlan(size_t size, bool isInversed)
+    : _rows(ChooseRows(size)), _columns(size / std::max<size_t>(_rows, 1)),
+      _isInversed(isInversed), _rowPlan(GetPlan<T>(_columns, isInversed)),
+      _columnPlan(GetPlan<T>(_rows, isInversed)) {
+  if (_rows < 2) {
+    throw std::invalid_argument("Parallel plan size can not be split!");
+  }
+  _twiddles.resize(size);
+  long double ang = (isInversed ? -2 : 2) * M_PIl / size;
+  for (size_t row = 0; row < _rows; ++row) {
+    for (size_t column = 0; column < _columns; ++column) {
+      long double phase = ang * (row * column % size);
+      _twiddles[row * _columns + column] =
+          Value(std::cos(phase), std::sin(phase));
+    }
+  }
+}
+
+// With x[r + rows * c], the transform is computed as: length-`columns`
+// transforms over c for every r, multiplication by w^(r * k), length-`rows`
+// transforms over r for every k, and a final transpose into X[k + columns * m].
+template <typename T>
+void BasicParallelPlan<T>::Execute(const Value *in, Value *out,
+                                   ThreadPool &pool) const {
+  // Reused across calls; the pool's workers only see it through `buffer`.
+  thread_local std::vector<Value> scratch;
+  if (scratch.size() < Size()) {
+    scratch.resize(Size());
+  }
+  Value *buffer = scratch.data();
+  Transpose(in, buffer, _columns, _rows, pool);
+  pool.ParallelFor(_rows, [&](size_t begin, size_t end) {
+    for (size_t row = begin; row < end; ++row) {
+      Value *data = buffer + row * _columns;
+      const Value *twiddles = _twiddles.data() + row * _columns;
+      _rowPlan->Execute(data, data);
+      for (size_t column = 0; column < _columns; ++column) {
+        data[column] *= twiddles[column];
+      }
+    }
+  });
+  Transpose(buffer, out, _rows, _columns, pool);
+  pool.ParallelFor(_columns, [&](size_t begin, size_t end) {
+    for (size_t column = begin; column < end; ++column) {
+      Value *data = out + column * _rows;
+      _columnPlan->Execute(data, data);
+    }
+  });
+  Transpose(out, buffer, _columns, _rows, pool);
+  pool.ParallelFor(_rows, [&](size_t begin, size_t end) {
+    std::copy(buffer + begin * _columns, buffer + end * _columns,
+              out + begin * _columns);
+  });
+}
+
+template <typename T>
+std::shared_ptr<const BasicParallelPlan<T>>
+GetParallelPlan(size_t size, bool isInversed) {
+  static PlanCache<std::pair<size_t, bool>, BasicParallelPlan<T>> plans(
+      PLAN_CACHE_SIZE);
+  return plans.Get({size, isInversed}, [&] {
+    return std::make_shared<BasicParallelPlan<T>>(size, isInversed);
+  });
+}
+
+void SetThreadCount(size_t count) {
+  std::lock_guard<std::mutex> lock(poolMutex);
+  count = std::max<size_t>(count, 1);
+  if (count != threadCount) {
+    // Transforms still running keep their own reference to the old pool.
+    pool.reset();
+    threadCount = count;
+  }
+}
+
+size_t ThreadCount() {
+  std::lock_guard<std::mutex> lock(poolMutex);
+  return threadCount;
+}
+
+std::shared_ptr<ThreadPool> GetThreadPool() {
+  std::lock_guard<std::mutex> lock(poolMutex);
+  if (!pool) {
+    pool = std::make_shared<ThreadPool>(threadCount);
+  }
+  return pool;
+}
+
+template class BasicParallelPlan<float>;
+template class BasicParallelPlan<double>;
+template class BasicParallelPlan<long double>;
+
+template std::shared_ptr<const BasicParallelPlan<float>>
+GetParallelPlan<float>(size_t, bool);
+template std::shared_ptr<const BasicParallelPlan<double>>
+GetParallelPlan<double>(size_t, bool);
+template std::shared_ptr<const BasicParallelPlan<long double>>
+GetParallelPlan<long double>(size_t, bool);
+} // namespace FFT
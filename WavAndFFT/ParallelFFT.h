@@ -0,0 +1,54 @@
+#pragma once
+
+#include "FFT.h"
+#include "ThreadPool.h"
+
+#include <memory>
+
+namespace FFT {
+// Four-step decomposition of a Size() = rows * columns transform: column
+// transforms, a twiddle pass and row transforms, each split across a pool and
+// separated by cache-blocked transposes.
+template <typename T> class BasicParallelPlan {
+public:
+  using Value = std::complex<T>;
+
+  BasicParallelPlan(size_t size, bool isInversed = false);
+
+  size_t Size() const { return _rows * _columns; }
+  bool IsInversed() const { return _isInversed; }
+
+  // `in` and `out` may point to the same buffer of Size() elements.
+  void Execute(const Value *in, Value *out, ThreadPool &pool) const;
+
+private:
+  size_t _rows;
+  size_t _columns;
+  bool _isInversed;
+  std::shared_ptr<const BasicPlan<T>> _rowPlan;
+  std::shared_ptr<const BasicPlan<T>> _columnPlan;
+  std::vector<Value> _twiddles;
+};
+
+using ParallelPlan = BasicParallelPlan<Real>;
+
+// Transforms at least this long are split across the pool when more than one
+// thread is configured.
+static const size_t PARALLEL_THRESHOLD = 1lu << 16lu;
+
+// Sizes that are prime (or too short) have no useful split.
+bool CanRunInParallel(size_t size);
+
+template <typename T = Real>
+std::shared_ptr<const BasicParallelPlan<T>>
+GetParallelPlan(size_t size, bool isInversed = false);
+
+void SetThreadCount(size_t threadCount);
+size_t ThreadCount();
+// Shared so that a transform in flight survives SetThreadCount().
+std::shared_ptr<ThreadPool> GetThreadPool();
+
+extern template class BasicParallelPlan<float>;
+extern template class BasicParallelPlan<double>;
+extern template class BasicParallelPlan<long double>;
+} // namespace FFT
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace FFT {
+// Plans kept per cache, well above the handful of sizes any one run needs.
+static const size_t PLAN_CACHE_SIZE = 32;
+
+// Thread-safe cache that keeps the `capacity` most recently used plans.
+// Evicted plans live on for as long as a caller still holds them, so a
+// one-off size can never pin its tables in memory for the whole run.
+template <typename Key, typename Plan> class PlanCache {
+public:
+  using Pointer = std::shared_ptr<const Plan>;
+
+  explicit PlanCache(size_t capacity) : _capacity(capacity) {}
+  PlanCache(const PlanCache &) = delete;
+  PlanCache &operator=(const PlanCache &) = delete;
+
+  // Returns the cached plan for `key`, building it with `make` on a miss.
+  template <typename Make> Pointer Get(const Key &key, Make &&make) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto found = _index.find(key);
+    if (found != _index.end()) {
+      _entries.splice(_entries.begin(), _entries, found->second);
+      return found->second->second;
+    }
+    Pointer plan = make();
+    _entries.emplace_front(key, plan);
+    _index[key] = _entries.begin();
+    if (_entries.size() > _capacity) {
+      _index.erase(_entries.back().first);
+      _entries.pop_back();
+    }
+    return plan;
+  }
+
+private:
+  using Entries = std::list<std::pair<Key, Pointer>>;
+
+  std::mutex _mutex;
+  size_t _capacity;
+  // Most recently used first.
+  Entries _entries;
+  std::map<Key, typename Entries::iterator> _index;
+};
+} // namespace FFT
@@ -0,0 +1,212 @@
+#include "Realtime.h"
+#include "SampleView.h"
+
+#include <cerrno>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <unistd.h>
+
+namespace Dsp {
+namespace {
+int64_t Now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+} // namespace
+
+RealtimeFilter::RealtimeFilter(const FilterSpec &spec,
+                               const RealtimeConfig &config)
+    : _config(config), _header(),
+      _input(config.blockFrames * config.queueBlocks * config.numChannels *
+             config.bitsPerSample / 8),
+      _output((config.blockFrames * config.queueBlocks + config.frameSize) *
+              config.numChannels * config.bitsPerSample / 8),
+      _arrivals(config.queueBlocks + 1) {
+  if (config.numChannels == 0 || config.blockFrames == 0) {
+    throw std::invalid_argument("Realtime mode needs channels and blocks!");
+  }
+  _header.audioFormat = 1;
+  _header.numChannels = config.numChannels;
+  _header.sampleRate = config.sampleRate;
+  _header.bitsPerSample = config.bitsPerSample;
+  _header.blockAlign = config.numChannels * config.bitsPerSample / 8;
+  _header.byteRate = config.sampleRate * _header.blockAlign;
+  Wav::GetSampleFormat(_header);
+  _blockBytes = config.blockFrames * _header.blockAlign;
+
+  FilterSpec framed = spec;
+  framed.frameSize = config.frameSize;
+  auto gains = DesignResponse(framed, config.sampleRate);
+  for (uint16_t channel = 0; channel < config.numChannels; ++channel) {
+    _filters.emplace_back(config.frameSize, gains);
+  }
+  // Enough room for a block plus everything a flush can release, so the
+  // hot path never reallocates.
+  size_t capacity = config.blockFrames + config.frameSize;
+  _block.resize(_blockBytes);
+  _samples.resize(config.blockFrames);
+  _filtered.resize(config.numChannels);
+  for (auto &filtered : _filtered) {
+    filtered.reserve(capacity);
+  }
+  _result.reserve(capacity * _header.blockAlign);
+}
+
+RealtimeStats RealtimeFilter::Run(int input, int output) {
+  RealtimeStats stats;
+  stats.filterDelay = double(_config.frameSize) / _config.sampleRate;
+  _inputDone = false;
+  _processingDone = false;
+  std::thread processor([&] { Process(stats); });
+  std::thread writer([&] { Write(output); });
+  try {
+    Read(input, stats);
+  } catch (...) {
+    _inputDone = true;
+    _inputReady.Notify();
+    processor.join();
+    writer.join();
+    throw;
+  }
+  processor.join();
+  writer.join();
+  return stats;
+}
+
+// A block is queued once it is complete, together with its arrival time.
+void RealtimeFilter::Read(int input, RealtimeStats &stats) {
+  std::vector<Wav::File::Byte> pending(_blockBytes);
+  size_t filled = 0;
+  bool isEnd = false;
+  while (!isEnd) {
+    ssize_t count = read(input, pending.data() + filled, _blockBytes - filled);
+    if (count < 0 && errno == EINTR) {
+      continue;
+    }
+    if (count < 0) {
+      throw std::runtime_error("Input can not be read!");
+    }
+    filled += count;
+    isEnd = count == 0;
+    if (filled < _blockBytes && !isEnd) {
+      continue;
+    }
+    // The arrival goes first, so it is queued before the block can be seen.
+    int64_t arrival = Now();
+    if (filled > 0) {
+      _inputSpace.Wait([&] { return _arrivals.Push(&arrival, 1) == 1; });
+      if (_input.Capacity() - _input.Available() < filled) {
+        ++stats.inputStalls;
+      }
+      for (size_t pushed = 0; pushed < filled;) {
+        pushed += _input.Push(pending.data() + pushed, filled - pushed);
+        _inputReady.Notify();
+        if (pushed < filled) {
+          _inputSpace.Wait(
+              [&] { return _input.Available() < _input.Capacity(); });
+        }
+      }
+    }
+    filled = 0;
+  }
+  _inputDone.store(true, std::memory_order_release);
+  _inputReady.Notify();
+}
+
+void RealtimeFilter::Process(RealtimeStats &stats) {
+  // Warm up the plans and this thread's FFT scratch before timing anything.
+  std::fill(_samples.begin(), _samples.end(), 0.);
+  for (size_t channel = 0; channel < _filters.size(); ++channel) {
+    _filters[channel].Process(_samples.data(), _samples.size(),
+                              _filtered[channel]);
+    _filtered[channel].clear();
+    _filters[channel].Reset();
+  }
+
+  double totalLatency = 0;
+  while (true) {
+    _inputReady.Wait([&] {
+      return _inputDone.load(std::memory_order_acquire) ||
+             _input.Available() >= _blockBytes;
+    });
+    bool isDone = _inputDone.load(std::memory_order_acquire);
+    size_t available = _input.Available();
+    bool isLast = isDone && available <= _blockBytes;
+    size_t bytes = std::min(available, _blockBytes);
+    bytes -= bytes % _header.blockAlign;
+    _input.Pop(_block.data(), bytes);
+    _inputSpace.Notify();
+    FilterBlock(bytes, isLast);
+
+    int64_t arrival;
+    if (bytes > 0 && _arrivals.Pop(&arrival, 1) == 1) {
+      _inputSpace.Notify();
+      double latency = (Now() - arrival) / 1e9;
+      stats.worstLatency = std::max(stats.worstLatency, latency);
+      totalLatency += latency;
+      ++stats.blocks;
+    }
+    if (isLast) {
+      break;
+    }
+  }
+  stats.meanLatency = stats.blocks ? totalLatency / stats.blocks : 0;
+  _processingDone.store(true, std::memory_order_release);
+  _outputReady.Notify();
+}
+
+void RealtimeFilter::FilterBlock(size_t bytes, bool isLast) {
+  size_t frames = bytes / _header.blockAlign;
+  for (uint16_t channel = 0; channel < _header.numChannels; ++channel) {
+    Wav::SampleView<double> view(_block.data(), frames, _header, channel);
+    view.CopyTo(_samples.data());
+    auto &filtered = _filtered[channel];
+    filtered.clear();
+    _filters[channel].Process(_samples.data(), frames, filtered);
+    if (isLast) {
+      _filters[channel].Flush(filtered);
+    }
+    _result.resize(filtered.size() * _header.blockAlign);
+    Wav::StoreSamples(filtered.data(), filtered.size(), _header, channel,
+                      _result.data());
+  }
+  for (size_t pushed = 0; pushed < _result.size();) {
+    pushed += _output.Push(_result.data() + pushed, _result.size() - pushed);
+    _outputReady.Notify();
+    if (pushed < _result.size()) {
+      _outputSpace.Wait(
+          [&] { return _output.Available() < _output.Capacity(); });
+    }
+  }
+}
+
+void RealtimeFilter::Write(int output) {
+  std::vector<Wav::File::Byte> chunk(_blockBytes);
+  while (true) {
+    _outputReady.Wait([&] {
+      return _processingDone.load(std::memory_order_acquire) ||
+             _output.Available() > 0;
+    });
+    bool isDone = _processingDone.load(std::memory_order_acquire);
+    size_t count = _output.Pop(chunk.data(), chunk.size());
+    _outputSpace.Notify();
+    if (count == 0) {
+      if (isDone) {
+        return;
+      }
+      continue;
+    }
+    for (size_t written = 0; written < count;) {
+      ssize_t result = write(output, chunk.data() + written, count - written);
+      if (result < 0 && errno != EINTR) {
+        // Keep draining so the processing thread never blocks on a closed
+        // pipe.
+        break;
+      }
+      written += std::max<ssize_t>(result, 0);
+    }
+  }
+}
+} // namespace Dsp
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "FilterDesign.h"
+#include "RingBuffer.h"
+#include "StftFilter.h"
+#include "WavReader.h"
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace Dsp {
+struct RealtimeConfig {
+  uint32_t sampleRate = 48000;
+  uint16_t numChannels = 1;
+  uint16_t bitsPerSample = 16;
+  size_t blockFrames = 256;
+  size_t frameSize = 1024;
+  // Capacity of the input and output queues in blocks.
+  size_t queueBlocks = 16;
+};
+
+struct RealtimeStats {
+  uint64_t blocks = 0;
+  // From the arrival of a block's last byte until its filtered samples are
+  // queued for output.
+  double worstLatency = 0;
+  double meanLatency = 0;
+  // Delay added by the STFT framing itself.
+  double filterDelay = 0;
+  // Times the reader found the input queue full.
+  uint64_t inputStalls = 0;
+};
+
+// Filters raw interleaved PCM from one file descriptor to another with
+// bounded latency. The calling thread reads fixed blocks into a lock-free
+// queue, a processing thread filters them with buffers allocated up front,
+// and a writer thread drains the output queue, so a slow consumer or
+// producer never stalls the filter itself.
+class RealtimeFilter {
+public:
+  RealtimeFilter(const FilterSpec &spec, const RealtimeConfig &config);
+
+  // Runs until `input` reaches end of file and all output is written.
+  RealtimeStats Run(int input, int output);
+
+private:
+  RealtimeConfig _config;
+  Wav::Header _header;
+  size_t _blockBytes;
+  std::vector<StftFilter> _filters;
+  RingBuffer<Wav::File::Byte> _input;
+  RingBuffer<Wav::File::Byte> _output;
+  RingBuffer<int64_t> _arrivals;
+  std::atomic<bool> _inputDone{false};
+  std::atomic<bool> _processingDone{false};
+  // Signalled on data or end of input, and when space is freed, per queue.
+  Wakeup _inputReady;
+  Wakeup _inputSpace;
+  Wakeup _outputReady;
+  Wakeup _outputSpace;
+
+  std::vector<Wav::File::Byte> _block;
+  std::vector<double> _samples;
+  std::vector<std::vector<double>> _filtered;
+  std::vector<Wav::File::Byte> _result;
+
+  void Read(int input, RealtimeStats &stats);
+  void Process(RealtimeStats &stats);
+  void Write(int output);
+  void FilterBlock(size_t bytes, bool isLast);
+};
+} // namespace Dsp
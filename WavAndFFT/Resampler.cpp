@@ -0,0 +1,128 @@
+#include "Resampler.h"
+
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
+#include <tuple>
+
+namespace Dsp {
+namespace {
+// Four independent partial sums let the loop vectorise without reassociating
+// a single floating point reduction.
+__attribute__((target_clones("avx2", "default"))) double
+Dot(const double *samples, const double *taps, size_t count) {
+  double sums[4] = {0, 0, 0, 0};
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    for (size_t lane = 0; lane < 4; ++lane) {
+      sums[lane] += samples[i + lane] * taps[i + lane];
+    }
+  }
+  for (; i < count; ++i) {
+    sums[0] += samples[i] * taps[i];
+  }
+  return (sums[0] + sums[1]) + (sums[2] + sums[3]);
+}
+} // namespace
+
+std::shared_ptr<const FilterBank>
+DesignFilterBank(uint32_t inputRate, uint32_t outputRate, size_t taps) {
+  if (inputRate == 0 || outputRate == 0 || taps < 2 || taps % 2 != 0) {
+    throw std::invalid_argument("Invalid resampling rates or taps!");
+  }
+  // The bank only depends on the reduced ratio, so 44100 -> 48000 and
+  // 22050 -> 24000 share one.
+  uint32_t divisor = std::gcd(inputRate, outputRate);
+  uint32_t up = outputRate / divisor, down = inputRate / divisor;
+  static std::mutex mutex;
+  static std::map<std::tuple<uint32_t, uint32_t, size_t>,
+                  std::shared_ptr<const FilterBank>>
+      banks;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto &cached = banks[{up, down, taps}];
+  if (cached) {
+    return cached;
+  }
+
+  auto bank = std::make_shared<FilterBank>();
+  bank->up = up;
+  bank->down = down;
+  // Downsampling narrows the passband, so the taps are stretched to keep
+  // the transition width relative to the output rate.
+  bank->taps = taps * ((bank->down + bank->up - 1) / bank->up);
+
+  // Blackman-windowed sinc at the upsampled rate with its cutoff a little
+  // below the lower of the two Nyquist frequencies, scaled by `up` to make
+  // up for the inserted zeros. It is centered on the sample length / 2, so
+  // the delay is a whole number of input samples.
+  size_t length = up * bank->taps;
+  double cutoff = 0.45 / std::max(bank->up, bank->down);
+  double middle = length / 2.;
+  std::vector<double> prototype(length);
+  for (size_t i = 0; i < length; ++i) {
+    double t = i - middle;
+    double sinc = t == 0 ? 2 * cutoff
+                         : std::sin(2 * M_PI * cutoff * t) / (M_PI * t);
+    double window = 0.42 + 0.5 * std::cos(M_PI * t / middle) +
+                    0.08 * std::cos(2 * M_PI * t / middle);
+    prototype[i] = sinc * window * up;
+  }
+  bank->coefficients.resize(length);
+  for (size_t phase = 0; phase < up; ++phase) {
+    for (size_t k = 0; k < bank->taps; ++k) {
+      bank->coefficients[phase * bank->taps + bank->taps - 1 - k] =
+          prototype[phase + k * up];
+    }
+  }
+  cached = std::move(bank);
+  return cached;
+}
+
+Resampler::Resampler(uint32_t inputRate, uint32_t outputRate, size_t taps)
+    : _bank(DesignFilterBank(inputRate, outputRate, taps)) {
+  Reset();
+}
+
+// The window for input i starts at buffer index i, behind taps - 1 zeros of
+// history. Starting taps / 2 inputs late cancels the filter delay.
+void Resampler::Reset() {
+  size_t taps = _bank->taps;
+  _buffer.assign(taps - 1, 0.);
+  _position = taps / 2;
+  _phase = 0;
+  _consumed = 0;
+  _produced = 0;
+}
+
+void Resampler::Process(const double *in, size_t count,
+                        std::vector<double> &out) {
+  const auto &bank = *_bank;
+  _buffer.insert(_buffer.end(), in, in + count);
+  _consumed += count;
+  while (_position + bank.taps <= _buffer.size()) {
+    out.push_back(Dot(_buffer.data() + _position, bank.Phase(_phase),
+                      bank.taps));
+    ++_produced;
+    _phase += bank.down;
+    _position += _phase / bank.up;
+    _phase %= bank.up;
+  }
+  _buffer.erase(_buffer.begin(), _buffer.begin() + _position);
+  _position = 0;
+}
+
+void Resampler::Flush(std::vector<double> &out) {
+  const auto &bank = *_bank;
+  uint64_t total = (_consumed * bank.up + bank.down - 1) / bank.down;
+  std::vector<double> silence(bank.taps, 0.);
+  while (_produced < total) {
+    uint64_t consumed = _consumed;
+    Process(silence.data(), silence.size(), out);
+    _consumed = consumed;
+  }
+  out.resize(out.size() - (_produced - total));
+  Reset();
+}
+} // namespace Dsp
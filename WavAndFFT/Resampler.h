@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Dsp {
+// Polyphase decomposition of a windowed-sinc low-pass for the rational
+// ratio up / down. Phase p holds the taps h[p + k * up] in reversed order,
+// so that every output sample is a plain dot product over the newest
+// `taps` input samples.
+struct FilterBank {
+  size_t up;
+  size_t down;
+  size_t taps;
+  std::vector<double> coefficients;
+
+  const double *Phase(size_t phase) const {
+    return coefficients.data() + phase * taps;
+  }
+};
+
+// `taps` is the filter length per phase when upsampling; downsampling by a
+// factor d stretches it to taps * ceil(d). Banks are designed once per
+// (input rate, output rate, taps) and shared.
+std::shared_ptr<const FilterBank>
+DesignFilterBank(uint32_t inputRate, uint32_t outputRate, size_t taps = 32);
+
+// Streaming rational resampler. Output is aligned with the input: the filter
+// delay is compensated, and after Flush ceil(input * up / down) samples have
+// been produced.
+class Resampler {
+public:
+  Resampler(uint32_t inputRate, uint32_t outputRate, size_t taps = 32);
+
+  void Process(const double *in, size_t count, std::vector<double> &out);
+  void Flush(std::vector<double> &out);
+  void Reset();
+
+private:
+  std::shared_ptr<const FilterBank> _bank;
+  std::vector<double> _buffer;
+  size_t _position = 0;
+  size_t _phase = 0;
+  uint64_t _consumed = 0;
+  uint64_t _produced = 0;
+};
+} // namespace Dsp
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+// Lock-free queue for exactly one producer thread and one consumer thread.
+// Storage is allocated once; Push and Pop only copy and publish indices.
+template <typename T> class RingBuffer {
+public:
+  // The capacity is rounded up to a power of two.
+  explicit RingBuffer(size_t capacity) {
+    size_t size = 1;
+    while (size < capacity) {
+      size <<= 1lu;
+    }
+    _items.resize(size);
+    _mask = size - 1;
+  }
+  RingBuffer(const RingBuffer &) = delete;
+  RingBuffer &operator=(const RingBuffer &) = delete;
+
+  size_t Capacity() const { return _items.size(); }
+
+  // Producer side: copies as many of `count` items as fit.
+  size_t Push(const T *items, size_t count) {
+    size_t tail = _tail.load(std::memory_order_relaxed);
+    size_t head = _head.load(std::memory_order_acquire);
+    count = std::min(count, Capacity() - (tail - head));
+    for (size_t i = 0; i < count; ++i) {
+      _items[(tail + i) & _mask] = items[i];
+    }
+    _tail.store(tail + count, std::memory_order_release);
+    return count;
+  }
+
+  // Consumer side: copies up to `count` items.
+  size_t Pop(T *items, size_t count) {
+    size_t head = _head.load(std::memory_order_relaxed);
+    size_t tail = _tail.load(std::memory_order_acquire);
+    count = std::min(count, tail - head);
+    for (size_t i = 0; i < count; ++i) {
+      items[i] = _items[(head + i) & _mask];
+    }
+    _head.store(head + count, std::memory_order_release);
+    return count;
+  }
+
+  // Number of items the consumer can pop.
+  size_t Available() const {
+    return _tail.load(std::memory_order_acquire) -
+           _head.load(std::memory_order_relaxed);
+  }
+
+private:
+  static constexpr size_t CACHE_LINE = 64;
+
+  std::vector<T> _items;
+  size_t _mask;
+  // Producer and consumer indices live on separate cache lines.
+  alignas(CACHE_LINE) std::atomic<size_t> _head{0};
+  alignas(CACHE_LINE) std::atomic<size_t> _tail{0};
+};
+
+// Parks a thread until another one publishes progress on a RingBuffer, so
+// waiting for space or data costs no CPU. Notify only touches the mutex when
+// someone is actually waiting, which keeps the queues lock-free otherwise.
+class Wakeup {
+public:
+  // Blocks until `isReady` returns true; it is re-checked after every Notify.
+  template <typename Predicate> void Wait(Predicate isReady) {
+    if (isReady()) {
+      return;
+    }
+    std::unique_lock<std::mutex> lock(_mutex);
+    _waiters.fetch_add(1);
+    while (!isReady()) {
+      _condition.wait(lock);
+    }
+    _waiters.fetch_sub(1);
+  }
+
+  // Call after every Push or Pop and whenever a done flag is set.
+  void Notify() {
+    // Orders the caller's ring update before the check for waiters.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (_waiters.load() == 0) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(_mutex);
+    _condition.notify_all();
+  }
+
+private:
+  std::mutex _mutex;
+  std::condition_variable _condition;
+  std::atomic<int> _waiters{0};
+};
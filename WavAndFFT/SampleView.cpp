@@ -0,0 +1,33 @@
+#include "SampleView.h"
+
+#include <stdexcept>
+
+namespace Wav {
+namespace {
+const uint16_t FORMAT_PCM = 1;
+const uint16_t FORMAT_IEEE_FLOAT = 3;
+} // namespace
+
+SampleFormat GetSampleFormat(const Header &header) {
+  if (header.audioFormat == FORMAT_PCM) {
+    switch (header.bitsPerSample) {
+    case 8:
+      return SampleFormat::PCM_U8;
+    case 16:
+      return SampleFormat::PCM_S16;
+    case 24:
+      return SampleFormat::PCM_S24;
+    case 32:
+      return SampleFormat::PCM_S32;
+    }
+  } else if (header.audioFormat == FORMAT_IEEE_FLOAT) {
+    switch (header.bitsPerSample) {
+    case 32:
+      return SampleFormat::FLOAT32;
+    case 64:
+      return SampleFormat::FLOAT64;
+    }
+  }
+  throw std::invalid_argument("Unsupported sample format!");
+}
+} // namespace Wav
@@ -0,0 +1,363 @@
+#pragma once
+
+#include "WavReader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+
+namespace Wav {
+enum class SampleFormat { PCM_U8, PCM_S16, PCM_S24, PCM_S32, FLOAT32, FLOAT64 };
+
+// Throws for encodings that can't be decoded.
+SampleFormat GetSampleFormat(const Header &header);
+
+constexpr uint16_t BytesPerSample(SampleFormat format) {
+  switch (format) {
+  case SampleFormat::PCM_U8:
+    return 1;
+  case SampleFormat::PCM_S16:
+    return 2;
+  case SampleFormat::PCM_S24:
+    return 3;
+  case SampleFormat::PCM_S32:
+  case SampleFormat::FLOAT32:
+    return 4;
+  case SampleFormat::FLOAT64:
+    return 8;
+  }
+  return 0;
+}
+
+// Samples are exchanged as floating point values in [-1, 1]; integer PCM is
+// scaled by its full range, unsigned 8-bit data is centered first.
+template <typename T> T DecodeSample(const File::Byte *bytes, SampleFormat format) {
+  static_assert(std::is_floating_point_v<T>, "Samples decode to floats");
+  switch (format) {
+  case SampleFormat::PCM_U8:
+    return (T(bytes[0]) - 128) / 128;
+  case SampleFormat::PCM_S16: {
+    int16_t value;
+    std::memcpy(&value, bytes, sizeof(value));
+    return T(value) / 32768;
+  }
+  case SampleFormat::PCM_S24: {
+    int32_t value = int32_t(uint32_t(bytes[0]) << 8u | uint32_t(bytes[1]) << 16u |
+                            uint32_t(bytes[2]) << 24u) >> 8;
+    return T(value) / 8388608;
+  }
+  case SampleFormat::PCM_S32: {
+    int32_t value;
+    std::memcpy(&value, bytes, sizeof(value));
+    return T(value) / 2147483648.;
+  }
+  case SampleFormat::FLOAT32: {
+    float value;
+    std::memcpy(&value, bytes, sizeof(value));
+    return T(value);
+  }
+  case SampleFormat::FLOAT64: {
+    double value;
+    std::memcpy(&value, bytes, sizeof(value));
+    return T(value);
+  }
+  }
+  return T();
+}
+
+// Rounds and saturates `value` into the integer range of `format`.
+template <typename T>
+void EncodeSample(T value, SampleFormat format, File::Byte *bytes) {
+  static_assert(std::is_floating_point_v<T>, "Samples encode from floats");
+  auto quantize = [value](double scale, double low, double high) {
+    return std::clamp(std::floor(double(value) * scale + 0.5), low, high);
+  };
+  switch (format) {
+  case SampleFormat::PCM_U8:
+    bytes[0] = static_cast<File::Byte>(quantize(128, -128, 127) + 128);
+    return;
+  case SampleFormat::PCM_S16: {
+    auto result = static_cast<int16_t>(quantize(32768, -32768, 32767));
+    std::memcpy(bytes, &result, sizeof(result));
+    return;
+  }
+  case SampleFormat::PCM_S24: {
+    auto result = static_cast<int32_t>(quantize(8388608, -8388608, 8388607));
+    bytes[0] = result & 0xFF;
+    bytes[1] = (result >> 8) & 0xFF;
+    bytes[2] = (result >> 16) & 0xFF;
+    return;
+  }
+  case SampleFormat::PCM_S32: {
+    auto result =
+        static_cast<int32_t>(quantize(2147483648., -2147483648., 2147483647.));
+    std::memcpy(bytes, &result, sizeof(result));
+    return;
+  }
+  case SampleFormat::FLOAT32: {
+    auto result = static_cast<float>(value);
+    std::memcpy(bytes, &result, sizeof(result));
+    return;
+  }
+  case SampleFormat::FLOAT64: {
+    auto result = static_cast<double>(value);
+    std::memcpy(bytes, &result, sizeof(result));
+    return;
+  }
+  }
+}
+
+// Strided, decoding view over one channel of interleaved frames. Nothing is
+// copied: every access decodes straight from the underlying bytes.
+template <typename T> class SampleView {
+public:
+  class Iterator {
+  public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = T;
+
+    Iterator(const SampleView *view, size_t index)
+        : _view(view), _index(index) {}
+
+    T operator*() const { return (*_view)[_index]; }
+    T operator[](difference_type offset) const {
+      return (*_view)[_index + offset];
+    }
+    Iterator &operator++() {
+      ++_index;
+      return *this;
+    }
+    Iterator operator++(int) { return {_view, _index++}; }
+    Iterator &operator--() {
+      --_index;
+      return *this;
+    }
+    Iterator &operator+=(difference_type offset) {
+      _index += offset;
+      return *this;
+    }
+    Iterator operator+(difference_type offset) const {
+      return {_view, _index + offset};
+    }
+    Iterator operator-(difference_type offset) const {
+      return {_view, _index - offset};
+    }
+    difference_type operator-(const Iterator &other) const {
+      return difference_type(_index) - difference_type(other._index);
+    }
+    bool operator==(const Iterator &other) const {
+      return _index == other._index;
+    }
+    bool operator!=(const Iterator &other) const {
+      return _index != other._index;
+    }
+    bool operator<(const Iterator &other) const {
+      return _index < other._index;
+    }
+
+  private:
+    const SampleView *_view;
+    size_t _index;
+  };
+
+  // `frames` points to `frameCount` interleaved frames laid out as `header`
+  // describes.
+  SampleView(const File::Byte *frames, size_t frameCount,
+             const Header &header, uint16_t channel)
+      : _format(GetSampleFormat(header)), _stride(header.blockAlign),
+        _size(frameCount) {
+    if (channel >= header.numChannels) {
+      throw std::out_of_range("There is no such channel!");
+    }
+    _first = frames + channel * BytesPerSample(_format);
+  }
+
+  size_t size() const { return _size; }
+  bool empty() const { return _size == 0; }
+  size_t Stride() const { return _stride; }
+  SampleFormat Format() const { return _format; }
+
+  T operator[](size_t index) const {
+    return DecodeSample<T>(_first + index * _stride, _format);
+  }
+
+  Iterator begin() const { return {this, 0}; }
+  Iterator end() const { return {this, _size}; }
+
+  // Decodes `count` samples starting at `first`; the format is dispatched
+  // once per call instead of once per sample.
+  void CopyTo(T *out, size_t first = 0, size_t count = SIZE_MAX) const {
+    count = std::min(count, _size - std::min(first, _size));
+    const File::Byte *bytes = _first + first * _stride;
+    switch (_format) {
+    case SampleFormat::PCM_U8:
+      Decode<SampleFormat::PCM_U8>(bytes, count, out);
+      return;
+    case SampleFormat::PCM_S16:
+      Decode<SampleFormat::PCM_S16>(bytes, count, out);
+      return;
+    case SampleFormat::PCM_S24:
+      Decode<SampleFormat::PCM_S24>(bytes, count, out);
+      return;
+    case SampleFormat::PCM_S32:
+      Decode<SampleFormat::PCM_S32>(bytes, count, out);
+      return;
+    case SampleFormat::FLOAT32:
+      Decode<SampleFormat::FLOAT32>(bytes, count, out);
+      return;
+    case SampleFormat::FLOAT64:
+      Decode<SampleFormat::FLOAT64>(bytes, count, out);
+      return;
+    }
+  }
+
+private:
+  const File::Byte *_first;
+  SampleFormat _format;
+  size_t _stride;
+  size_t _size;
+
+  template <SampleFormat F>
+  void Decode(const File::Byte *bytes, size_t count, T *out) const {
+    for (size_t i = 0; i < count; ++i, bytes += _stride) {
+      out[i] = DecodeSample<T>(bytes, F);
+    }
+  }
+};
+
+// Encodes `count` samples into one channel of interleaved frames.
+template <typename T>
+void StoreSamples(const T *samples, size_t count, const Header &header,
+                  uint16_t channel, File::Byte *frames) {
+  SampleFormat format = GetSampleFormat(header);
+  File::Byte *bytes = frames + channel * BytesPerSample(format);
+  for (size_t i = 0; i < count; ++i, bytes += header.blockAlign) {
+    EncodeSample(samples[i], format, bytes);
+  }
+}
+
+namespace Detail {
+template <typename T, SampleFormat F, uint16_t CHANNELS>
+void Deinterleave(const File::Byte *frames, size_t count, uint16_t channels,
+                  size_t stride, T *const *planes) {
+  if (CHANNELS != 0) {
+    channels = CHANNELS;
+  }
+  constexpr size_t width = BytesPerSample(F);
+  for (uint16_t channel = 0; channel < channels; ++channel) {
+    const File::Byte *bytes = frames + channel * width;
+    T *plane = planes[channel];
+    for (size_t i = 0; i < count; ++i) {
+      plane[i] = DecodeSample<T>(bytes + i * stride, F);
+    }
+  }
+}
+
+template <typename T, SampleFormat F, uint16_t CHANNELS>
+void Interleave(const T *const *planes, size_t count, uint16_t channels,
+                size_t stride, File::Byte *frames) {
+  if (CHANNELS != 0) {
+    channels = CHANNELS;
+  }
+  constexpr size_t width = BytesPerSample(F);
+  for (uint16_t channel = 0; channel < channels; ++channel) {
+    File::Byte *bytes = frames + channel * width;
+    const T *plane = planes[channel];
+    for (size_t i = 0; i < count; ++i) {
+      EncodeSample(plane[i], F, bytes + i * stride);
+    }
+  }
+}
+
+// Mono and stereo get a compile-time channel count so that the loops unroll.
+template <typename Run> void DispatchChannels(uint16_t channels, Run &&run) {
+  switch (channels) {
+  case 1:
+    run(std::integral_constant<uint16_t, 1>());
+    return;
+  case 2:
+    run(std::integral_constant<uint16_t, 2>());
+    return;
+  default:
+    run(std::integral_constant<uint16_t, 0>());
+  }
+}
+
+template <typename Run> void DispatchFormat(SampleFormat format, Run &&run) {
+  switch (format) {
+  case SampleFormat::PCM_U8:
+    run(std::integral_constant<SampleFormat, SampleFormat::PCM_U8>());
+    return;
+  case SampleFormat::PCM_S16:
+    run(std::integral_constant<SampleFormat, SampleFormat::PCM_S16>());
+    return;
+  case SampleFormat::PCM_S24:
+    run(std::integral_constant<SampleFormat, SampleFormat::PCM_S24>());
+    return;
+  case SampleFormat::PCM_S32:
+    run(std::integral_constant<SampleFormat, SampleFormat::PCM_S32>());
+    return;
+  case SampleFormat::FLOAT32:
+    run(std::integral_constant<SampleFormat, SampleFormat::FLOAT32>());
+    return;
+  case SampleFormat::FLOAT64:
+    run(std::integral_constant<SampleFormat, SampleFormat::FLOAT64>());
+    return;
+  }
+}
+} // namespace Detail
+
+// Splits `count` interleaved frames into one contiguous plane per channel
+// (header.numChannels pointers, `count` samples each). The format and, for
+// mono and stereo, the channel count are fixed at compile time for the
+// inner loops.
+template <typename T>
+void Deinterleave(const File::Byte *frames, size_t count, const Header &header,
+                  T *const *planes) {
+  uint16_t channels = header.numChannels;
+  Detail::DispatchFormat(GetSampleFormat(header), [&](auto format) {
+    Detail::DispatchChannels(channels, [&](auto fixed) {
+      Detail::Deinterleave<T, format(), fixed()>(frames, count, channels,
+                                                 header.blockAlign, planes);
+    });
+  });
+}
+
+// The inverse of Deinterleave.
+template <typename T>
+void Interleave(const T *const *planes, size_t count, const Header &header,
+                File::Byte *frames) {
+  uint16_t channels = header.numChannels;
+  Detail::DispatchFormat(GetSampleFormat(header), [&](auto format) {
+    Detail::DispatchChannels(channels, [&](auto fixed) {
+      Detail::Interleave<T, format(), fixed()>(planes, count, channels,
+                                               header.blockAlign, frames);
+    });
+  });
+}
+
+// Averages the channels of `count` interleaved frames into `out`.
+template <typename T>
+void MixSamples(const File::Byte *frames, size_t count, const Header &header,
+                T *out) {
+  std::fill(out, out + count, T(0));
+  for (uint16_t channel = 0; channel < header.numChannels; ++channel) {
+    SampleView<T> view(frames, count, header, channel);
+    for (size_t i = 0; i < count; ++i) {
+      out[i] += view[i] / header.numChannels;
+    }
+  }
+}
+
+template <typename T> SampleView<T> File::Samples(uint16_t channel) const {
+  auto data = Data();
+  size_t frames = _header.blockAlign ? data.size / _header.blockAlign : 0;
+  return SampleView<T>(data.data, frames, _header, channel);
+}
+} // namespace Wav
@@ -0,0 +1,193 @@
+#include "Spectrogram.h"
+#include "SampleView.h"
+#include "WavReader.h"
+
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace Dsp {
+namespace {
+double HzToMel(double hz) { return 2595. * std::log10(1. + hz / 700.); }
+
+double MelToHz(double mel) { return 700. * (std::pow(10., mel / 2595.) - 1.); }
+
+// Digits only, so signs and fractions can't wrap into huge sizes.
+size_t ParseValue(const std::string &text, const std::string &option) {
+  bool isDigits = !text.empty() && text.find_first_not_of("0123456789") ==
+                                       std::string::npos;
+  try {
+    if (isDigits) {
+      return std::stoul(text);
+    }
+  } catch (const std::exception &) {
+  }
+  throw std::invalid_argument("Malformed spectrogram option: " + option);
+}
+} // namespace
+
+SpectrogramSpec ParseSpectrogramSpec(const std::string &text) {
+  SpectrogramSpec spec;
+  std::istringstream options(text);
+  std::string option;
+  while (std::getline(options, option, ',')) {
+    if (option.empty()) {
+      continue;
+    }
+    auto separator = option.find('=');
+    if (separator == std::string::npos) {
+      throw std::invalid_argument("Unknown spectrogram option: " + option);
+    }
+    auto key = option.substr(0, separator);
+    auto value = ParseValue(option.substr(separator + 1), option);
+    if (key == "frame") {
+      spec.frameSize = value;
+    } else if (key == "hop") {
+      spec.hopSize = value;
+    } else if (key == "mel") {
+      spec.melBands = value;
+    } else {
+      throw std::invalid_argument("Unknown spectrogram option: " + option);
+    }
+  }
+  return spec;
+}
+
+Spectrogram::Spectrogram(const SpectrogramSpec &spec, uint32_t sampleRate)
+    : _plan(FFT::GetRealPlan<double>(spec.frameSize)),
+      _hopSize(spec.hopSize) {
+  size_t frameSize = spec.frameSize;
+  if (frameSize < 2 || _hopSize == 0) {
+    throw std::invalid_argument("Invalid spectrogram frame or hop size!");
+  }
+  _window.resize(frameSize);
+  for (size_t i = 0; i < frameSize; ++i) {
+    _window[i] = 0.5 - 0.5 * std::cos(2 * M_PI * i / frameSize);
+  }
+  _input.resize(frameSize);
+  _frame.resize(frameSize);
+  _spectrum.resize(_plan->SpectrumSize());
+
+  // Triangular bands evenly spaced on the mel scale up to Nyquist.
+  if (spec.melBands > 0) {
+    double top = HzToMel(sampleRate / 2.);
+    double binWidth = double(sampleRate) / frameSize;
+    for (size_t band = 0; band < spec.melBands; ++band) {
+      double low = MelToHz(top * band / (spec.melBands + 1));
+      double center = MelToHz(top * (band + 1) / (spec.melBands + 1));
+      double high = MelToHz(top * (band + 2) / (spec.melBands + 1));
+      MelBand melBand{size_t(std::ceil(low / binWidth)), {}};
+      for (size_t bin = melBand.first; bin < _spectrum.size(); ++bin) {
+        double hz = bin * binWidth;
+        if (hz >= high) {
+          break;
+        }
+        melBand.weights.push_back(hz <= center ? (hz - low) / (center - low)
+                                               : (high - hz) / (high - center));
+      }
+      _melBands.push_back(std::move(melBand));
+    }
+  }
+}
+
+size_t Spectrogram::Bins() const {
+  return _melBands.empty() ? _spectrum.size() : _melBands.size();
+}
+
+void Spectrogram::Process(const double *in, size_t count,
+                          std::vector<float> &out) {
+  size_t frameSize = FrameSize();
+  while (count > 0) {
+    // A hop longer than the frame drops the samples between frames.
+    size_t skipped = std::min(count, _skip);
+    _skip -= skipped;
+    in += skipped;
+    count -= skipped;
+
+    size_t taken = std::min(count, frameSize - _filled);
+    std::copy(in, in + taken, _input.begin() + _filled);
+    _filled += taken;
+    in += taken;
+    count -= taken;
+    if (_filled == frameSize) {
+      ProcessFrame(out);
+    }
+  }
+}
+
+void Spectrogram::ProcessFrame(std::vector<float> &out) {
+  size_t frameSize = FrameSize();
+  for (size_t i = 0; i < frameSize; ++i) {
+    _frame[i] = _input[i] * _window[i];
+  }
+  _plan->Forward(_frame.data(), _spectrum.data());
+  if (_melBands.empty()) {
+    for (const auto &value : _spectrum) {
+      out.push_back(float(std::abs(value)));
+    }
+  } else {
+    for (const auto &band : _melBands) {
+      double energy = 0;
+      for (size_t i = 0; i < band.weights.size(); ++i) {
+        energy += band.weights[i] * std::norm(_spectrum[band.first + i]);
+      }
+      out.push_back(float(energy));
+    }
+  }
+
+  if (_hopSize < frameSize) {
+    std::copy(_input.begin() + _hopSize, _input.end(), _input.begin());
+    _filled = frameSize - _hopSize;
+  } else {
+    _skip = _hopSize - frameSize;
+    _filled = 0;
+  }
+}
+
+uint64_t ExtractFeatures(const std::string &inputPath,
+                         const std::string &outputPath,
+                         const SpectrogramSpec &spec) {
+  const size_t BLOCK_FRAMES = 1lu << 14lu;
+  Wav::File input;
+  input.Open(inputPath);
+  const auto &wavHeader = input.GetHeader();
+  Spectrogram spectrogram(spec, wavHeader.sampleRate);
+
+  FeatureHeader header{};
+  std::copy(FeatureHeader::MAGIC, FeatureHeader::MAGIC + 4, header.magic);
+  header.version = 1;
+  header.kind = spec.melBands > 0 ? FeatureHeader::MEL : FeatureHeader::MAGNITUDE;
+  header.sampleRate = wavHeader.sampleRate;
+  header.frameSize = spectrogram.FrameSize();
+  header.hopSize = spectrogram.HopSize();
+  header.bins = spectrogram.Bins();
+
+  std::ofstream output(outputPath, std::ios::binary | std::ios::trunc);
+  if (!output) {
+    throw std::runtime_error("File can not be openned!");
+  }
+  output.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+  std::vector<Wav::File::Byte> block;
+  std::vector<double> mixed;
+  std::vector<float> features;
+  while (input.ReadBlock(block, BLOCK_FRAMES * wavHeader.blockAlign) > 0) {
+    size_t frames = block.size() / wavHeader.blockAlign;
+    mixed.resize(frames);
+    Wav::MixSamples(block.data(), frames, wavHeader, mixed.data());
+    features.clear();
+    spectrogram.Process(mixed.data(), frames, features);
+    output.write(reinterpret_cast<const char *>(features.data()),
+                 features.size() * sizeof(float));
+    header.frameCount += features.size() / header.bins;
+  }
+
+  output.seekp(0);
+  output.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  if (!output.flush()) {
+    throw std::runtime_error("File can not be written!");
+  }
+  return header.frameCount;
+}
+} // namespace Dsp
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "FFT.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Dsp {
+struct SpectrogramSpec {
+  size_t frameSize = 1024;
+  size_t hopSize = 256;
+  // Zero keeps the frameSize / 2 + 1 magnitudes, anything else sums the
+  // power spectrum into that many mel bands.
+  size_t melBands = 0;
+};
+
+// Parses "frame=1024,hop=256,mel=64"; omitted keys keep their defaults.
+SpectrogramSpec ParseSpectrogramSpec(const std::string &text);
+
+// Layout of the feature file: this header followed by frameCount rows of
+// `bins` little-endian float32 values. frameCount is patched once the whole
+// input is consumed.
+#pragma pack(push, 1)
+struct FeatureHeader {
+  static constexpr char MAGIC[4] = {'W', 'F', 'E', 'A'};
+  static const uint16_t MAGNITUDE = 0, MEL = 1;
+
+  char magic[4];
+  uint16_t version;
+  uint16_t kind;
+  uint32_t sampleRate;
+  uint32_t frameSize;
+  uint32_t hopSize;
+  uint32_t bins;
+  uint64_t frameCount;
+};
+#pragma pack(pop)
+
+// Hann-windowed STFT of a mono signal that keeps only the samples of the
+// frame not yet analysed, so memory does not depend on the input length.
+class Spectrogram {
+public:
+  Spectrogram(const SpectrogramSpec &spec, uint32_t sampleRate);
+
+  size_t Bins() const;
+  size_t FrameSize() const { return _plan->Size(); }
+  size_t HopSize() const { return _hopSize; }
+
+  // Appends Bins() values per completed frame to `out`.
+  void Process(const double *in, size_t count, std::vector<float> &out);
+
+private:
+  struct MelBand {
+    size_t first;
+    std::vector<double> weights;
+  };
+
+  std::shared_ptr<const FFT::BasicRealPlan<double>> _plan;
+  size_t _hopSize;
+  std::vector<double> _window;
+  std::vector<MelBand> _melBands;
+  std::vector<double> _input;
+  std::vector<double> _frame;
+  std::vector<std::complex<double>> _spectrum;
+  size_t _filled = 0;
+  size_t _skip = 0;
+
+  void ProcessFrame(std::vector<float> &out);
+};
+
+// Writes the features of `inputPath`, with its channels averaged, to
+// `outputPath`, and returns the number of frames.
+uint64_t ExtractFeatures(const std::string &inputPath,
+                         const std::string &outputPath,
+                         const SpectrogramSpec &spec);
+} // namespace Dsp
@@ -0,0 +1,100 @@
+#include "StftFilter.h"
+#include "Trace.h"
+
+#include <cmath>
+#include <stdexcept>
+
+namespace Dsp {
+StftFilter::StftFilter(size_t frameSize, Response gains)
+    : _plan(FFT::GetRealPlan<double>(frameSize)) {
+  if (frameSize < 2 || frameSize % 2 != 0) {
+    throw std::invalid_argument("Frame size must be even!");
+  }
+  SetGains(std::move(gains));
+  _window.resize(frameSize);
+  for (size_t i = 0; i < frameSize; ++i) {
+    _window[i] = std::sin(M_PI * i / frameSize);
+  }
+  _input.resize(frameSize);
+  _overlap.resize(frameSize);
+  _frame.resize(frameSize);
+  _spectrum.resize(_plan->SpectrumSize());
+  Reset();
+}
+
+void StftFilter::SetGains(Response gains) {
+  if (!gains || gains->size() != _plan->SpectrumSize()) {
+    throw std::invalid_argument("There must be one gain per bin!");
+  }
+  _gains = std::move(gains);
+}
+
+// The first frame starts half a frame before the signal, so that every
+// emitted sample is covered by two overlapping windows.
+void StftFilter::Reset() {
+  std::fill(_input.begin(), _input.end(), 0.);
+  std::fill(_overlap.begin(), _overlap.end(), 0.);
+  _filled = HopSize();
+  _consumed = 0;
+  _emitted = 0;
+  _skipped = 0;
+}
+
+void StftFilter::Process(const double *in, size_t count,
+                         std::vector<double> &out) {
+  Trace::Scope scope("Dsp::StftFilter");
+  scope.SetSize(FrameSize());
+  scope.SetBytes(count * sizeof(double));
+  size_t frameSize = FrameSize();
+  _consumed += count;
+  while (count > 0) {
+    size_t taken = std::min(count, frameSize - _filled);
+    std::copy(in, in + taken, _input.begin() + _filled);
+    _filled += taken;
+    in += taken;
+    count -= taken;
+    if (_filled == frameSize) {
+      ProcessFrame(out);
+    }
+  }
+}
+
+void StftFilter::ProcessFrame(std::vector<double> &out) {
+  size_t frameSize = FrameSize(), hop = HopSize();
+  for (size_t i = 0; i < frameSize; ++i) {
+    _frame[i] = _input[i] * _window[i];
+  }
+  _plan->Forward(_frame.data(), _spectrum.data());
+  // One pass over the interleaved spectrum applies the whole response.
+  auto *values = reinterpret_cast<double *>(_spectrum.data());
+  const double *gains = _gains->data();
+  for (size_t i = 0; i < _spectrum.size(); ++i) {
+    values[2 * i] *= gains[i];
+    values[2 * i + 1] *= gains[i];
+  }
+  _plan->Inverse(_spectrum.data(), _frame.data());
+  for (size_t i = 0; i < frameSize; ++i) {
+    _overlap[i] += _frame[i] * _window[i];
+  }
+
+  size_t skip = hop - _skipped;
+  _skipped = hop;
+  for (size_t i = skip; i < hop && _emitted < _consumed; ++i, ++_emitted) {
+    out.push_back(_overlap[i]);
+  }
+  std::copy(_overlap.begin() + hop, _overlap.end(), _overlap.begin());
+  std::fill(_overlap.begin() + hop, _overlap.end(), 0.);
+  std::copy(_input.begin() + hop, _input.end(), _input.begin());
+  _filled -= hop;
+}
+
+void StftFilter::Flush(std::vector<double> &out) {
+  size_t frameSize = FrameSize();
+  while (_emitted < _consumed) {
+    std::fill(_input.begin() + _filled, _input.end(), 0.);
+    _filled = frameSize;
+    ProcessFrame(out);
+  }
+  Reset();
+}
+} // namespace Dsp
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "FFT.h"
+#include "FilterDesign.h"
+
+#include <vector>
+
+namespace Dsp {
+// Streaming frequency-domain filter: frames of FrameSize() samples taken
+// every HopSize() samples are windowed, multiplied by a fixed gain per bin
+// and overlap-added back. A square-root periodic Hann window is used for
+// both analysis and synthesis, so an all-pass response reproduces the input.
+class StftFilter {
+public:
+  // `gains` holds one real gain for each of the frameSize / 2 + 1 bins.
+  StftFilter(size_t frameSize, Response gains);
+
+  // Swaps the response without touching buffered samples.
+  void SetGains(Response gains);
+
+  size_t FrameSize() const { return _plan->Size(); }
+  size_t HopSize() const { return _plan->Size() / 2; }
+
+  // Consumes `count` samples and appends every output sample that became
+  // final to `out`; output lags input by at most FrameSize() samples and
+  // does not allocate once `out` has enough capacity.
+  void Process(const double *in, size_t count, std::vector<double> &out);
+
+  // Appends the remaining output so that in total exactly as many samples
+  // were produced as consumed, and resets the filter.
+  void Flush(std::vector<double> &out);
+
+  // Drops buffered input and output.
+  void Reset();
+
+private:
+  std::shared_ptr<const FFT::BasicRealPlan<double>> _plan;
+  std::vector<double> _window;
+  Response _gains;
+  std::vector<double> _input;
+  std::vector<double> _overlap;
+  std::vector<double> _frame;
+  std::vector<std::complex<double>> _spectrum;
+  size_t _filled = 0;
+  uint64_t _consumed = 0;
+  uint64_t _emitted = 0;
+  size_t _skipped = 0;
+
+  void ProcessFrame(std::vector<double> &out);
+};
+} // namespace Dsp
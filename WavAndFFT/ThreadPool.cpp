@@ -0,0 +1,88 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+
+ThreadPool::ThreadPool(size_t threadCount) {
+  threadCount = std::max<size_t>(threadCount, 1);
+  _workers.reserve(threadCount);
+  for (size_t i = 0; i < threadCount; ++i) {
+    _workers.emplace_back([this] { Work(); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stopping = true;
+  }
+  _condition.notify_all();
+  for (auto &worker : _workers) {
+    worker.join();
+  }
+}
+
+void ThreadPool::Enqueue(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _tasks.push(std::move(task));
+  }
+  _condition.notify_one();
+}
+
+void ThreadPool::Work() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _condition.wait(lock, [this] { return _stopping || !_tasks.empty(); });
+      if (_tasks.empty()) {
+        return;
+      }
+      task = std::move(_tasks.front());
+      _tasks.pop();
+    }
+    task();
+  }
+}
+
+void ThreadPool::ParallelFor(size_t count,
+                             const std::function<void(size_t, size_t)> &body) {
+  if (count == 0) {
+    return;
+  }
+  size_t chunkCount = std::min(count, 4 * Size());
+  if (chunkCount < 2) {
+    body(0, count);
+    return;
+  }
+  struct State {
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> done{0};
+    std::mutex mutex;
+    std::condition_variable finished;
+  };
+  auto state = std::make_shared<State>();
+  size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+  chunkCount = (count + chunkSize - 1) / chunkSize;
+  // `body` outlives every chunk because the caller waits for all of them;
+  // helpers that start late find no chunk left and never touch it.
+  auto runChunks = [state, &body, count, chunkSize, chunkCount] {
+    for (size_t chunk = state->next++; chunk < chunkCount;
+         chunk = state->next++) {
+      size_t begin = chunk * chunkSize;
+      body(begin, std::min(count, begin + chunkSize));
+      if (++state->done == chunkCount) {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->finished.notify_all();
+      }
+    }
+  };
+  size_t helpers = std::min(Size(), chunkCount - 1);
+  for (size_t i = 0; i < helpers; ++i) {
+    Enqueue(runChunks);
+  }
+  runChunks();
+  std::unique_lock<std::mutex> lock(state->mutex);
+  state->finished.wait(lock, [&] { return state->done == chunkCount; });
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+public:
+  explicit ThreadPool(size_t threadCount);
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+  ~ThreadPool();
+
+  size_t Size() const { return _workers.size(); }
+
+  template <typename F> auto Submit(F &&task) -> std::future<decltype(task())> {
+    using Result = decltype(task());
+    auto packaged =
+        std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+    auto future = packaged->get_future();
+    Enqueue([packaged] { (*packaged)(); });
+    return future;
+  }
+
+  // Splits [0, count) into chunks and runs `body(begin, end)` on them. The
+  // calling thread takes chunks too, so nested calls from a worker finish
+  // even when every other worker is busy.
+  void ParallelFor(size_t count,
+                   const std::function<void(size_t, size_t)> &body);
+
+private:
+  std::vector<std::thread> _workers;
+  std::queue<std::function<void()>> _tasks;
+  std::mutex _mutex;
+  std::condition_variable _condition;
+  bool _stopping = false;
+
+  void Enqueue(std::function<void()> task);
+  void Work();
+};
@@ -0,0 +1,165 @@
+#include "ToneDetector.h"
+#include "SampleView.h"
+#include "WavReader.h"
+
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+namespace Dsp {
+namespace {
+// s0 = x + c * s1 - s2 for every resonator; the frequencies are the inner
+// loop, so it vectorises across them.
+__attribute__((target_clones("avx2", "default"))) void
+RunResonators(const double *in, size_t count, const double *coefficients,
+              double *state1, double *state2, size_t tones) {
+  for (size_t i = 0; i < count; ++i) {
+    double x = in[i];
+    for (size_t k = 0; k < tones; ++k) {
+      double s0 = x + coefficients[k] * state1[k] - state2[k];
+      state2[k] = state1[k];
+      state1[k] = s0;
+    }
+  }
+}
+} // namespace
+
+const std::vector<double> &DtmfFrequencies() {
+  static const std::vector<double> frequencies = {697,  770,  852,  941,
+                                                  1209, 1336, 1477, 1633};
+  return frequencies;
+}
+
+std::vector<double> ParseFrequencies(const std::string &text) {
+  if (text == "dtmf") {
+    return DtmfFrequencies();
+  }
+  std::vector<double> frequencies;
+  std::istringstream list(text);
+  std::string frequency;
+  while (std::getline(list, frequency, ',')) {
+    size_t parsed = 0;
+    double value = 0;
+    try {
+      value = std::stod(frequency, &parsed);
+    } catch (const std::exception &) {
+      parsed = 0;
+    }
+    if (parsed == 0 || parsed != frequency.size() || !std::isfinite(value)) {
+      throw std::invalid_argument("Malformed frequency list: " + text);
+    }
+    frequencies.push_back(value);
+  }
+  return frequencies;
+}
+
+ToneDetector::ToneDetector(std::vector<double> frequencies,
+                           uint32_t sampleRate, size_t blockSize,
+                           double thresholdDb)
+    : _frequencies(std::move(frequencies)), _sampleRate(sampleRate),
+      _blockSize(blockSize),
+      _threshold(thresholdDb) {
+  if (_frequencies.empty() || blockSize == 0) {
+    throw std::invalid_argument("Detector needs tones and a block size!");
+  }
+  for (double frequency : _frequencies) {
+    // Written so that NaN fails it as well.
+    if (!(frequency > 0 && 2 * frequency < sampleRate)) {
+      throw std::invalid_argument("Tone frequency must be below Nyquist!");
+    }
+    _coefficients.push_back(2 * std::cos(2 * M_PI * frequency / sampleRate));
+  }
+  _state1.resize(_frequencies.size());
+  _state2.resize(_frequencies.size());
+  Reset();
+}
+
+void ToneDetector::Reset() {
+  std::fill(_state1.begin(), _state1.end(), 0.);
+  std::fill(_state2.begin(), _state2.end(), 0.);
+  _filled = 0;
+  _block = 0;
+}
+
+void ToneDetector::Process(const double *in, size_t count,
+                           std::vector<ToneDetection> &out) {
+  while (count > 0) {
+    size_t taken = std::min(count, _blockSize - _filled);
+    RunResonators(in, taken, _coefficients.data(), _state1.data(),
+                  _state2.data(), _frequencies.size());
+    _filled += taken;
+    in += taken;
+    count -= taken;
+    if (_filled == _blockSize) {
+      FinishBlock(out);
+    }
+  }
+}
+
+size_t ToneDetector::Flush(std::vector<ToneDetection> &out) {
+  size_t pending = _filled;
+  if (2 * pending < _blockSize) {
+    std::fill(_state1.begin(), _state1.end(), 0.);
+    std::fill(_state2.begin(), _state2.end(), 0.);
+    _filled = 0;
+    return pending;
+  }
+  FinishBlock(out);
+  return 0;
+}
+
+// |X|^2 = s1^2 + s2^2 - c * s1 * s2, and a sine of amplitude A gives
+// |X| = A * N / 2 at its own frequency, with N the samples in the block.
+void ToneDetector::FinishBlock(std::vector<ToneDetection> &out) {
+  for (size_t k = 0; k < _frequencies.size(); ++k) {
+    double s1 = _state1[k], s2 = _state2[k];
+    double power = s1 * s1 + s2 * s2 - _coefficients[k] * s1 * s2;
+    double amplitude = 2 * std::sqrt(std::max(power, 0.)) / _filled;
+    double level = 20 * std::log10(std::max(amplitude, 1e-12));
+    if (level >= _threshold) {
+      double time = double(_block) * _blockSize / _sampleRate;
+      out.push_back({_block, time, k, _frequencies[k], level});
+    }
+  }
+  std::fill(_state1.begin(), _state1.end(), 0.);
+  std::fill(_state2.begin(), _state2.end(), 0.);
+  _filled = 0;
+  ++_block;
+}
+
+size_t ScanTones(const std::string &path,
+                 const std::vector<double> &frequencies, double blockSeconds,
+                 double thresholdDb,
+                 const std::function<void(const ToneDetection &)> &onDetection) {
+  const size_t BLOCK_FRAMES = 1lu << 14lu;
+  if (!(blockSeconds > 0)) {
+    throw std::invalid_argument("Block length must be positive!");
+  }
+  Wav::File input;
+  input.Open(path);
+  const auto &header = input.GetHeader();
+  size_t blockSize =
+      std::max<size_t>(1, std::lround(blockSeconds * header.sampleRate));
+  ToneDetector detector(frequencies, header.sampleRate, blockSize, thresholdDb);
+
+  std::vector<Wav::File::Byte> block;
+  std::vector<double> mixed;
+  std::vector<ToneDetection> detections;
+  while (input.ReadBlock(block, BLOCK_FRAMES * header.blockAlign) > 0) {
+    size_t frames = block.size() / header.blockAlign;
+    mixed.resize(frames);
+    Wav::MixSamples(block.data(), frames, header, mixed.data());
+    detections.clear();
+    detector.Process(mixed.data(), frames, detections);
+    for (const auto &detection : detections) {
+      onDetection(detection);
+    }
+  }
+  detections.clear();
+  size_t skipped = detector.Flush(detections);
+  for (const auto &detection : detections) {
+    onDetection(detection);
+  }
+  return skipped;
+}
+} // namespace Dsp
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace Dsp {
+struct ToneDetection {
+  uint64_t block;
+  // Start of the block in seconds.
+  double time;
+  size_t tone;
+  double frequency;
+  // Estimated sine amplitude in dB relative to full scale.
+  double level;
+};
+
+// Row and column frequencies of the DTMF keypad.
+const std::vector<double> &DtmfFrequencies();
+
+// Parses "dtmf" or a comma separated list of frequencies in Hz.
+std::vector<double> ParseFrequencies(const std::string &text);
+
+// Goertzel resonators for a set of frequencies, run over fixed blocks. The
+// resonator states are kept as arrays so that every input sample updates
+// all frequencies in one vectorised loop.
+class ToneDetector {
+public:
+  ToneDetector(std::vector<double> frequencies, uint32_t sampleRate,
+               size_t blockSize, double thresholdDb);
+
+  size_t BlockSize() const { return _blockSize; }
+
+  // Appends one detection per tone whose level in a completed block reaches
+  // the threshold.
+  void Process(const double *in, size_t count, std::vector<ToneDetection> &out);
+  // Analyses a pending partial block if it holds at least half a block and
+  // returns the number of samples dropped otherwise.
+  size_t Flush(std::vector<ToneDetection> &out);
+  void Reset();
+
+private:
+  std::vector<double> _frequencies;
+  uint32_t _sampleRate;
+  size_t _blockSize;
+  double _threshold;
+  std::vector<double> _coefficients;
+  std::vector<double> _state1;
+  std::vector<double> _state2;
+  size_t _filled = 0;
+  uint64_t _block = 0;
+
+  void FinishBlock(std::vector<ToneDetection> &out);
+};
+
+// Streams the channel average of `path` through a detector with blocks of
+// `blockSeconds` and passes every detection to `onDetection`. Returns the
+// number of trailing frames that were too few to analyse.
+size_t ScanTones(const std::string &path,
+                 const std::vector<double> &frequencies, double blockSeconds,
+                 double thresholdDb,
+                 const std::function<void(const ToneDetection &)> &onDetection);
+} // namespace Dsp
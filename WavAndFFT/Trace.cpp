@@ -0,0 +1,209 @@
+#include "Trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+thread_local uint64_t allocations = 0;
+} // namespace
+
+// While tracing, every allocation bumps a thread-local counter, so scopes can
+// report how many allocations they made without any synchronisation.
+void *operator new(size_t size) {
+  if (Trace::IsEnabled()) {
+    ++allocations;
+  }
+  if (void *pointer = std::malloc(size ? size : 1)) {
+    return pointer;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept { std::free(pointer); }
+
+void operator delete(void *pointer, size_t) noexcept { std::free(pointer); }
+
+namespace Trace {
+std::atomic<bool> enabled{false};
+
+namespace {
+struct Event {
+  const char *name;
+  uint32_t thread;
+  int64_t start;
+  int64_t duration;
+  uint64_t allocations;
+  uint64_t bytes;
+  uint64_t size;
+};
+
+// Events are collected per thread and drained to the file in batches, so
+// scopes on different threads never contend and memory stays bounded.
+constexpr size_t BATCH_EVENTS = 1024;
+
+struct Buffer;
+
+struct Recorder {
+  // Guards everything below and is taken before any Buffer's mutex.
+  std::mutex mutex;
+  std::ofstream output;
+  Format format = Format::CHROME;
+  bool isFirst = true;
+  std::vector<Buffer *> buffers;
+};
+
+// Never destroyed, since pool threads may drain their buffers during exit.
+Recorder &GetRecorder() {
+  static Recorder *recorder = new Recorder();
+  return *recorder;
+}
+
+int64_t Now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+uint32_t ThreadIndex() {
+  static std::atomic<uint32_t> next{0};
+  thread_local uint32_t index = next++;
+  return index;
+}
+
+void WriteEvent(Recorder &recorder, const Event &event) {
+  auto &os = recorder.output;
+  if (recorder.format == Format::JSON_LINES) {
+    os << "{\"name\":\"" << event.name << "\",\"thread\":" << event.thread
+       << ",\"start_us\":" << event.start / 1e3
+       << ",\"duration_us\":" << event.duration / 1e3
+       << ",\"allocations\":" << event.allocations
+       << ",\"bytes\":" << event.bytes << ",\"size\":" << event.size << "}\n";
+    return;
+  }
+  os << (recorder.isFirst ? "" : ",\n") << "{\"name\":\"" << event.name
+     << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread
+     << ",\"ts\":" << event.start / 1e3 << ",\"dur\":" << event.duration / 1e3
+     << ",\"args\":{\"allocations\":" << event.allocations
+     << ",\"bytes\":" << event.bytes << ",\"size\":" << event.size << "}}";
+  recorder.isFirst = false;
+}
+
+struct Buffer {
+  std::mutex mutex;
+  std::vector<Event> events;
+
+  Buffer() {
+    events.reserve(BATCH_EVENTS);
+    auto &recorder = GetRecorder();
+    std::lock_guard<std::mutex> lock(recorder.mutex);
+    recorder.buffers.push_back(this);
+  }
+  ~Buffer() {
+    auto &recorder = GetRecorder();
+    std::lock_guard<std::mutex> lock(recorder.mutex);
+    Drain(recorder);
+    recorder.buffers.erase(
+        std::find(recorder.buffers.begin(), recorder.buffers.end(), this));
+  }
+
+  // The recorder's mutex must be held.
+  void Drain(Recorder &recorder) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (recorder.output.is_open()) {
+      for (const auto &event : events) {
+        WriteEvent(recorder, event);
+      }
+    }
+    events.clear();
+  }
+};
+
+Buffer &GetBuffer() {
+  thread_local Buffer buffer;
+  return buffer;
+}
+} // namespace
+
+Format FormatForPath(const std::string &path) {
+  const std::string extension = ".jsonl";
+  bool isJsonLines = path.size() >= extension.size() &&
+                     path.compare(path.size() - extension.size(),
+                                  extension.size(), extension) == 0;
+  return isJsonLines ? Format::JSON_LINES : Format::CHROME;
+}
+
+void Start(const std::string &path, Format format) {
+  auto &recorder = GetRecorder();
+  std::lock_guard<std::mutex> lock(recorder.mutex);
+  for (auto *buffer : recorder.buffers) {
+    std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+    buffer->events.clear();
+  }
+  recorder.output.close();
+  recorder.output.clear();
+  recorder.output.open(path, std::ios::trunc);
+  if (!recorder.output) {
+    throw std::runtime_error("File can not be openned!");
+  }
+  recorder.output.precision(15);
+  recorder.format = format;
+  recorder.isFirst = true;
+  if (format == Format::CHROME) {
+    recorder.output << "{\"traceEvents\":[\n";
+  }
+  enabled.store(true, std::memory_order_relaxed);
+}
+
+void Stop() {
+  enabled.store(false, std::memory_order_relaxed);
+  auto &recorder = GetRecorder();
+  std::lock_guard<std::mutex> lock(recorder.mutex);
+  if (!recorder.output.is_open()) {
+    return;
+  }
+  for (auto *buffer : recorder.buffers) {
+    buffer->Drain(recorder);
+  }
+  if (recorder.format == Format::CHROME) {
+    recorder.output << "\n],\"displayTimeUnit\":\"ms\"}\n";
+  }
+  recorder.output.close();
+  if (!recorder.output) {
+    throw std::runtime_error("File can not be written!");
+  }
+}
+
+uint64_t AllocationCount() { return allocations; }
+
+void Scope::Begin(const char *name) {
+  _name = name;
+  _allocations = allocations;
+  _start = Now();
+}
+
+void Scope::End() {
+  int64_t end = Now();
+  Event event{_name,  ThreadIndex(), _start, end - _start,
+              allocations - _allocations, _bytes, _size};
+  auto &buffer = GetBuffer();
+  {
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    if (!IsEnabled()) {
+      return;
+    }
+    buffer.events.push_back(event);
+    if (buffer.events.size() < BATCH_EVENTS) {
+      return;
+    }
+  }
+  auto &recorder = GetRecorder();
+  std::lock_guard<std::mutex> lock(recorder.mutex);
+  buffer.Drain(recorder);
+}
+} // namespace Trace
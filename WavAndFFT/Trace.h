@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Scoped timers with byte, size and allocation counters. Nothing is recorded
+// until Start() is called; a disabled Scope costs one relaxed atomic load.
+namespace Trace {
+enum class Format { JSON_LINES, CHROME };
+
+// Chooses JSON_LINES for paths ending in ".jsonl" and CHROME otherwise.
+Format FormatForPath(const std::string &path);
+
+// Streams events to `path` in per-thread batches until Stop() completes it.
+void Start(const std::string &path, Format format);
+void Stop();
+
+extern std::atomic<bool> enabled;
+
+inline bool IsEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+// Heap allocations made by the calling thread so far.
+uint64_t AllocationCount();
+
+class Scope {
+public:
+  explicit Scope(const char *name) {
+    if (IsEnabled()) {
+      Begin(name);
+    }
+  }
+  Scope(const Scope &) = delete;
+  Scope &operator=(const Scope &) = delete;
+  ~Scope() {
+    if (_name) {
+      End();
+    }
+  }
+
+  void SetBytes(uint64_t bytes) { _bytes = bytes; }
+  // Transform or frame size handled by the scope.
+  void SetSize(uint64_t size) { _size = size; }
+
+private:
+  const char *_name = nullptr;
+  int64_t _start = 0;
+  uint64_t _allocations = 0;
+  uint64_t _bytes = 0;
+  uint64_t _size = 0;
+
+  void Begin(const char *name);
+  void End();
+};
+} // namespace Trace
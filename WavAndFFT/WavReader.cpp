@@ -1,9 +1,16 @@
 #include "WavReader.h"
+#include "ChunkIterator.h"
+#include "Trace.h"
 
+#include <algorithm>
 #include <fstream>
 #include <iomanip>
 #include <istream>
 #include <iterator>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace Wav {
 
@@ -30,20 +37,79 @@ std::ostream &operator<<(std::ostream &os, const File &file) {
   return os;
 }
 
-void File::LoadHeader(const std::vector<Byte> &fileData) {
-  _header.chunkId = {fileData.begin(), fileData.begin() + 4};
-  _header.chunkSize = FromBytesToInt<uint32_t, 4>(fileData.begin() + 4);
-  _header.format = {fileData.begin() + 8, fileData.begin() + 12};
-  _header.subchunk1Id = {fileData.begin() + 12, fileData.begin() + 16};
-  _header.subchunk1Size = FromBytesToInt<uint32_t, 4>(fileData.begin() + 16);
-  _header.audioFormat = FromBytesToInt<uint16_t, 2>(fileData.begin() + 20);
-  _header.numChannels = FromBytesToInt<uint16_t, 2>(fileData.begin() + 22);
-  _header.sampleRate = FromBytesToInt<uint32_t, 4>(fileData.begin() + 24);
-  _header.byteRate = FromBytesToInt<uint32_t, 4>(fileData.begin() + 28);
-  _header.blockAlign = FromBytesToInt<uint16_t, 2>(fileData.begin() + 32);
-  _header.bitsPerSample = FromBytesToInt<uint16_t, 2>(fileData.begin() + 34);
-  _header.subchunk2Id = {fileData.begin() + 36, fileData.begin() + 40};
-  _header.subchunk2Size = FromBytesToInt<uint32_t, 4>(fileData.begin() + 40);
+namespace {
+// Wraps a memory block so that in-memory files share the chunk parser.
+class MemoryBuffer : public std::streambuf {
+public:
+  MemoryBuffer(const File::Byte *data, size_t size) {
+    auto *begin = reinterpret_cast<char *>(const_cast<File::Byte *>(data));
+    setg(begin, begin, begin + size);
+  }
+
+protected:
+  pos_type seekoff(off_type offset, std::ios_base::seekdir direction,
+                   std::ios_base::openmode) override {
+    char *base = direction == std::ios_base::beg   ? eback()
+                 : direction == std::ios_base::cur ? gptr()
+                                                   : egptr();
+    if (base + offset < eback() || base + offset > egptr()) {
+      return pos_type(off_type(-1));
+    }
+    setg(eback(), base + offset, egptr());
+    return gptr() - eback();
+  }
+
+  pos_type seekpos(pos_type position, std::ios_base::openmode mode) override {
+    return seekoff(position, std::ios_base::beg, mode);
+  }
+};
+} // namespace
+
+void File::LoadHeader(std::istream &stream) {
+  const uint16_t FORMAT_EXTENSIBLE = 0xFFFE;
+  ChunkIterator chunks(stream);
+  _header.chunkId = chunks.RiffId();
+  _header.chunkSize = chunks.RiffSize();
+  _header.format = "WAVE";
+  bool hasFormat = false, hasData = false;
+  Chunk chunk;
+  while (!(hasFormat && hasData) && chunks.Next(chunk)) {
+    if (chunk.id == "fmt " && chunk.size >= 16) {
+      auto body = chunks.ReadBody(chunk, 40);
+      if (body.size() < 16) {
+        break;
+      }
+      _header.subchunk1Id = chunk.id;
+      _header.subchunk1Size = chunk.size;
+      _header.audioFormat = FromBytesToInt<uint16_t, 2>(body.data());
+      _header.numChannels = FromBytesToInt<uint16_t, 2>(body.data() + 2);
+      _header.sampleRate = FromBytesToInt<uint32_t, 4>(body.data() + 4);
+      _header.byteRate = FromBytesToInt<uint32_t, 4>(body.data() + 8);
+      _header.blockAlign = FromBytesToInt<uint16_t, 2>(body.data() + 12);
+      _header.bitsPerSample = FromBytesToInt<uint16_t, 2>(body.data() + 14);
+      // WAVE_FORMAT_EXTENSIBLE keeps the real format code at the start of
+      // its sub-format GUID.
+      if (_header.audioFormat == FORMAT_EXTENSIBLE && body.size() >= 26) {
+        _header.audioFormat = FromBytesToInt<uint16_t, 2>(body.data() + 24);
+      }
+      hasFormat = true;
+    } else if (chunk.id == "data") {
+      _header.subchunk2Id = chunk.id;
+      _header.subchunk2Size = chunk.size;
+      _header.dataOffset = chunk.offset;
+      hasData = true;
+    }
+  }
+  if (!hasFormat || !hasData) {
+    throw std::runtime_error("File has no fmt or data chunk!");
+  }
+  // Sample access strides by blockAlign, so it must hold exactly one sample
+  // per channel.
+  uint32_t width = (_header.bitsPerSample + 7) / 8;
+  if (_header.numChannels == 0 ||
+      _header.blockAlign != _header.numChannels * width) {
+    throw std::runtime_error("File has an invalid block align!");
+  }
 }
 
 File::Duration File::ComputeDuration() const {
@@ -57,37 +123,130 @@ File::Duration File::ComputeDuration() const {
   return d;
 }
 
+void File::Unmapper::operator()(Byte *address) const {
+  munmap(address, size);
+}
+
+void File::Reset() {
+  _mapping.reset();
+  _data.clear();
+  _bytes = nullptr;
+  _size = 0;
+  _stream = std::ifstream();
+  _remaining = 0;
+}
+
 void File::Load(const std::string &filePath) {
-  std::ifstream file(filePath, std::ios::binary);
+  Trace::Scope scope("Wav::Load");
+  Reset();
+  std::ifstream file(filePath, std::ios::binary | std::ios::ate);
   if (!file.good()) {
     throw std::runtime_error("File not found!");
   }
-  file.unsetf(std::ios::skipws);
-  std::istream_iterator<Byte> begin(file), end;
-  _data = {begin, end};
-  LoadHeader(_data);
+  _data.resize(file.tellg());
+  file.seekg(0);
+  file.read(reinterpret_cast<char *>(_data.data()), _data.size());
+  _bytes = _data.data();
+  _size = _data.size();
+  scope.SetBytes(_size);
+  LoadHeaderFromMemory();
+}
+
+void File::Map(const std::string &filePath) {
+  Trace::Scope scope("Wav::Map");
+  Reset();
+  int descriptor = open(filePath.c_str(), O_RDONLY);
+  if (descriptor < 0) {
+    throw std::runtime_error("File not found!");
+  }
+  struct stat status {};
+  if (fstat(descriptor, &status) != 0 || status.st_size == 0) {
+    close(descriptor);
+    throw std::runtime_error("File can not be mapped!");
+  }
+  size_t size = status.st_size;
+  void *address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                       descriptor, 0);
+  close(descriptor);
+  if (address == MAP_FAILED) {
+    throw std::runtime_error("File can not be mapped!");
+  }
+  madvise(address, size, MADV_SEQUENTIAL);
+  _mapping = std::unique_ptr<Byte, Unmapper>(static_cast<Byte *>(address),
+                                             Unmapper{size});
+  _bytes = _mapping.get();
+  _size = size;
+  scope.SetBytes(_size);
+  LoadHeaderFromMemory();
+}
+
+void File::LoadHeaderFromMemory() {
+  MemoryBuffer buffer(_bytes, _size);
+  std::istream stream(&buffer);
+  LoadHeader(stream);
   _duration = ComputeDuration();
 }
 
+// Only the bytes in front of the samples, metadata chunks included, are held
+// in memory; the payload stays on disk for ReadBlock.
+void File::Open(const std::string &filePath) {
+  Reset();
+  _stream = std::ifstream(filePath, std::ios::binary);
+  if (!_stream.good()) {
+    throw std::runtime_error("File not found!");
+  }
+  LoadHeader(_stream);
+  _duration = ComputeDuration();
+  _data.resize(_header.dataOffset);
+  _stream.clear();
+  _stream.seekg(0);
+  _stream.read(reinterpret_cast<char *>(_data.data()), _data.size());
+  _bytes = _data.data();
+  _size = _data.size();
+  _remaining = _header.subchunk2Size;
+}
+
+size_t File::ReadBlock(std::vector<Byte> &block, size_t size) {
+  Trace::Scope scope("Wav::ReadBlock");
+  size = std::min<uint64_t>(size, _remaining);
+  block.resize(size);
+  _stream.read(reinterpret_cast<char *>(block.data()), size);
+  size_t read = _stream.gcount();
+  block.resize(read);
+  _remaining = read < size ? 0 : _remaining - read;
+  scope.SetBytes(read);
+  return read;
+}
+
 void File::Save(const std::string &filePath) const {
+  Trace::Scope scope("Wav::Save");
+  scope.SetBytes(_size);
   std::ofstream file(filePath, std::ios::binary);
   if (!file.good()) {
     throw std::runtime_error("File can not be openned!");
   }
-  file.unsetf(std::ios::skipws);
-  std::ostream_iterator<Byte> out(file);
-  std::copy(_data.begin(), _data.end(), out);
+  file.write(reinterpret_cast<const char *>(_bytes), _size);
+}
+
+File::DataView File::Data() const {
+  if (_size <= _header.dataOffset) {
+    return {nullptr, 0};
+  }
+  return {_bytes + _header.dataOffset,
+          std::min<uint64_t>(_header.subchunk2Size, _size - _header.dataOffset)};
 }
 
 std::vector<File::Byte> File::ExtractData() const {
-  return {_data.begin() + HEADER_SIZE, _data.end()};
+  auto data = Data();
+  return {data.begin(), data.end()};
 }
 
 void File::UpdateData(const std::vector<File::Byte> &newData) {
-  if (_data.size() != HEADER_SIZE + newData.size()) {
+  auto data = Data();
+  if (data.size != newData.size()) {
     throw std::invalid_argument(
         "Header won't be correct after update.\nSizes don't match.");
   }
-  std::copy(newData.begin(), newData.end(), _data.begin() + HEADER_SIZE);
+  std::copy(newData.begin(), newData.end(), _bytes + _header.dataOffset);
 }
 } // namespace Wav
@@ -4,16 +4,23 @@
 #include <cstdio>
 #include <cstring>
 #include <endian.h>
+#include <fstream>
 #include <iostream>
+#include <memory>
 #include <vector>
 
 namespace Wav {
 
+// Size of the canonical header written by tools that have no metadata chunks;
+// loaded files may place their `fmt ` and `data` chunks anywhere.
 static const uint16_t HEADER_SIZE = 44;
 
+template <typename T> class SampleView;
+
+// Sizes are widened to 64 bits so that RF64 files report their real sizes.
 struct Header {
   std::string chunkId;
-  uint32_t chunkSize;
+  uint64_t chunkSize;
   std::string format;
   std::string subchunk1Id;
   uint32_t subchunk1Size;
@@ -24,7 +31,9 @@ struct Header {
   uint16_t blockAlign;
   uint16_t bitsPerSample;
   std::string subchunk2Id;
-  uint32_t subchunk2Size;
+  uint64_t subchunk2Size;
+  // Position of the first sample from the start of the file.
+  uint64_t dataOffset;
 };
 
 class File {
@@ -36,27 +45,73 @@ public:
     uint8_t seconds;
   };
 
+  // Read-only window over bytes owned by a File.
+  struct DataView {
+    const Byte *data;
+    size_t size;
+
+    const Byte *begin() const { return data; }
+    const Byte *end() const { return data + size; }
+  };
+
   File() = default;
 
   void Load(const std::string &filePath);
 
+  // Maps the whole file into memory instead of copying it. The payload is
+  // then served straight from the mapping; pages are private, so UpdateData
+  // never modifies the file on disk.
+  void Map(const std::string &filePath);
+
+  // Reads only the header and keeps the file open so that the payload can be
+  // consumed block by block with ReadBlock.
+  void Open(const std::string &filePath);
+
+  // Reads up to `size` payload bytes into `block` and returns how many were
+  // read; zero means the payload is exhausted.
+  size_t ReadBlock(std::vector<Byte> &block, size_t size);
+
+  const Header &GetHeader() const { return _header; }
+
   void Save(const std::string &filePath) const;
 
   friend std::ostream &operator<<(std::ostream &os, const File &file);
 
+  // Payload bytes without a copy; valid while the file is neither reloaded
+  // nor destroyed.
+  DataView Data() const;
+
+  // Decoding view over one channel of the payload; defined in SampleView.h.
+  template <typename T> SampleView<T> Samples(uint16_t channel) const;
+
   std::vector<Byte> ExtractData() const;
 
   void UpdateData(const std::vector<Byte> &newData);
 
 private:
-  using DataIt = std::vector<Byte>::const_iterator;
+  using DataIt = const Byte *;
+
+  struct Unmapper {
+    size_t size;
+    void operator()(Byte *address) const;
+  };
+
   Header _header;
   std::vector<Byte> _data;
+  std::unique_ptr<Byte, Unmapper> _mapping{nullptr, Unmapper{0}};
+  // Whole file contents, held either by `_data` or by `_mapping`.
+  Byte *_bytes = nullptr;
+  size_t _size = 0;
   Duration _duration{};
+  std::ifstream _stream;
+  uint64_t _remaining = 0;
 
   Duration ComputeDuration() const;
 
-  void LoadHeader(const std::vector<Byte> &fileData);
+  void LoadHeader(std::istream &stream);
+  void LoadHeaderFromMemory();
+
+  void Reset();
 
   template <typename T, uint8_t N> T FromBytesToInt(DataIt begin) {
     T res = 0;
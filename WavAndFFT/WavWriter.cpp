@@ -0,0 +1,165 @@
+#include "WavWriter.h"
+#include "Trace.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <fcntl.h>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace Wav {
+namespace {
+const size_t ALIGNMENT = 4096;
+const uint64_t RIFF_LIMIT = 0xFFFFFFFFlu;
+// RIFF (12) + JUNK/ds64 (8 + 28) + fmt (8 + 16) + data (8).
+const size_t WRITTEN_HEADER_SIZE = 80;
+const size_t DS64_SIZE = 28;
+
+template <typename T> void Append(std::vector<File::Byte> &bytes, T value) {
+  const auto *begin = reinterpret_cast<const File::Byte *>(&value);
+  bytes.insert(bytes.end(), begin, begin + sizeof(T));
+}
+
+void Append(std::vector<File::Byte> &bytes, const char *id) {
+  bytes.insert(bytes.end(), id, id + 4);
+}
+} // namespace
+
+Writer::Writer(const std::string &filePath, const Header &header,
+               size_t bufferSize)
+    : _header(header),
+      _capacity(std::max(ALIGNMENT, bufferSize / ALIGNMENT * ALIGNMENT)) {
+  SampleFormat format = GetSampleFormat(header);
+  _header.blockAlign = header.numChannels * BytesPerSample(format);
+  _header.byteRate = header.sampleRate * _header.blockAlign;
+  _header.subchunk1Id = "fmt ";
+  _header.subchunk1Size = 16;
+  _header.subchunk2Id = "data";
+  _header.dataOffset = WRITTEN_HEADER_SIZE;
+  _buffer.reset(
+      static_cast<File::Byte *>(std::aligned_alloc(ALIGNMENT, _capacity)));
+  if (!_buffer) {
+    throw std::bad_alloc();
+  }
+  _descriptor = open(filePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (_descriptor < 0) {
+    throw std::runtime_error("File can not be openned!");
+  }
+  // Sizes are unknown yet; the header is rewritten on Close.
+  auto placeholder = MakeHeader();
+  try {
+    WriteFully(placeholder.data(), placeholder.size());
+  } catch (...) {
+    close(_descriptor);
+    throw;
+  }
+}
+
+Writer::~Writer() {
+  try {
+    Close();
+  } catch (...) {
+  }
+}
+
+void Writer::Write(const File::Byte *bytes, size_t size) {
+  if (_descriptor < 0) {
+    throw std::logic_error("Writer is closed!");
+  }
+  _dataSize += size;
+  if (_used == 0 && size >= _capacity) {
+    WriteFully(bytes, size);
+    return;
+  }
+  while (size > 0) {
+    size_t taken = std::min(size, _capacity - _used);
+    std::copy(bytes, bytes + taken, _buffer.get() + _used);
+    _used += taken;
+    bytes += taken;
+    size -= taken;
+    if (_used == _capacity) {
+      Flush();
+    }
+  }
+}
+
+void Writer::Flush() {
+  WriteFully(_buffer.get(), _used);
+  _used = 0;
+}
+
+void Writer::WriteFully(const File::Byte *bytes, size_t size) {
+  Trace::Scope scope("Wav::Write");
+  scope.SetBytes(size);
+  while (size > 0) {
+    ssize_t written = write(_descriptor, bytes, size);
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written < 0) {
+      throw std::runtime_error("File can not be written!");
+    }
+    bytes += written;
+    size -= written;
+  }
+}
+
+std::vector<File::Byte> Writer::MakeHeader() const {
+  uint64_t riffSize = WRITTEN_HEADER_SIZE - 8 + _dataSize + (_dataSize & 1u);
+  bool isRf64 = riffSize > RIFF_LIMIT;
+  std::vector<File::Byte> bytes;
+  bytes.reserve(WRITTEN_HEADER_SIZE);
+  Append(bytes, isRf64 ? "RF64" : "RIFF");
+  Append<uint32_t>(bytes, isRf64 ? RIFF_LIMIT : riffSize);
+  Append(bytes, "WAVE");
+  Append(bytes, isRf64 ? "ds64" : "JUNK");
+  Append<uint32_t>(bytes, DS64_SIZE);
+  Append<uint64_t>(bytes, isRf64 ? riffSize : 0);
+  Append<uint64_t>(bytes, isRf64 ? _dataSize : 0);
+  Append<uint64_t>(bytes, isRf64 ? _dataSize / _header.blockAlign : 0);
+  Append<uint32_t>(bytes, 0);
+  Append(bytes, "fmt ");
+  Append<uint32_t>(bytes, 16);
+  Append<uint16_t>(bytes, _header.audioFormat);
+  Append<uint16_t>(bytes, _header.numChannels);
+  Append<uint32_t>(bytes, _header.sampleRate);
+  Append<uint32_t>(bytes, _header.byteRate);
+  Append<uint16_t>(bytes, _header.blockAlign);
+  Append<uint16_t>(bytes, _header.bitsPerSample);
+  Append(bytes, "data");
+  Append<uint32_t>(bytes, isRf64 ? RIFF_LIMIT : _dataSize);
+  return bytes;
+}
+
+void Writer::Close() {
+  if (_descriptor < 0) {
+    return;
+  }
+  // The descriptor is released on every path, even when flushing fails.
+  bool patched = false;
+  try {
+    if (_dataSize & 1u) {
+      File::Byte pad = 0;
+      Write(&pad, 1);
+      --_dataSize;
+    }
+    Flush();
+    _header.subchunk2Size = _dataSize;
+    auto header = MakeHeader();
+    ssize_t written;
+    do {
+      written = pwrite(_descriptor, header.data(), header.size(), 0);
+    } while (written < 0 && errno == EINTR);
+    patched = written == static_cast<ssize_t>(header.size());
+  } catch (...) {
+    close(_descriptor);
+    _descriptor = -1;
+    throw;
+  }
+  close(_descriptor);
+  _descriptor = -1;
+  if (!patched) {
+    throw std::runtime_error("File header can not be written!");
+  }
+}
+} // namespace Wav
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "SampleView.h"
+#include "WavReader.h"
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+namespace Wav {
+// Streams a WAVE file to disk block by block. Bytes go through a large
+// page-aligned buffer that is flushed with plain write calls; the RIFF and
+// data sizes are patched in place on Close. A JUNK chunk reserves room for
+// a ds64 chunk, so outputs beyond 4 GiB are turned into RF64 files.
+class Writer {
+public:
+  static const size_t DEFAULT_BUFFER_SIZE = 1lu << 20lu;
+
+  // Takes the sample format, channel count and sample rate from `header`;
+  // the other fields are derived from them.
+  Writer(const std::string &filePath, const Header &header,
+         size_t bufferSize = DEFAULT_BUFFER_SIZE);
+  Writer(const Writer &) = delete;
+  Writer &operator=(const Writer &) = delete;
+  ~Writer();
+
+  const Header &GetHeader() const { return _header; }
+  uint64_t DataSize() const { return _dataSize; }
+
+  // Appends raw interleaved sample bytes.
+  void Write(const File::Byte *bytes, size_t size);
+  void Write(const std::vector<File::Byte> &bytes) {
+    Write(bytes.data(), bytes.size());
+  }
+
+  // Encodes `frames` interleaved frames of normalised samples.
+  template <typename T> void WriteSamples(const T *samples, size_t frames) {
+    if (_descriptor < 0) {
+      throw std::logic_error("Writer is closed!");
+    }
+    SampleFormat format = GetSampleFormat(_header);
+    uint16_t width = BytesPerSample(format);
+    size_t count = frames * _header.numChannels;
+    for (size_t i = 0; i < count; ++i) {
+      if (_capacity - _used < width) {
+        Flush();
+      }
+      EncodeSample(samples[i], format, _buffer.get() + _used);
+      _used += width;
+      _dataSize += width;
+    }
+  }
+
+  // Flushes the buffer and completes the header; called by the destructor
+  // if needed, where errors can't be reported.
+  void Close();
+
+private:
+  struct Deleter {
+    void operator()(File::Byte *buffer) const { std::free(buffer); }
+  };
+
+  int _descriptor = -1;
+  Header _header;
+  std::unique_ptr<File::Byte, Deleter> _buffer;
+  size_t _capacity;
+  size_t _used = 0;
+  uint64_t _dataSize = 0;
+
+  void Flush();
+  void WriteFully(const File::Byte *bytes, size_t size);
+  std::vector<File::Byte> MakeHeader() const;
+};
+} // namespace Wav
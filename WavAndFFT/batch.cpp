@@ -0,0 +1,192 @@
+#include "FilterPipeline.h"
+#include "Trace.h"
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <iomanip>
+#include <map>
+
+namespace fs = std::filesystem;
+
+namespace {
+struct Job {
+  fs::path input;
+  fs::path output;
+};
+
+void PrintUsage() {
+  std::cerr << "Usage: WavBatch [-j threads] [-f spec] [-r rate] "
+               "[-o directory] [-t trace] <directory | list.txt | file.wav>...\n"
+               "  -j  number of files processed at once (default: all cores)\n"
+               "  -f  filter spec (default: portion:0.8)\n"
+               "  -r  resample every file to this rate first (default: keep)\n"
+               "  -o  output directory (default: filtered)\n"
+               "  -t  record a Chrome trace, or JSON lines for *.jsonl\n";
+}
+
+// Digits only, between 1 and `limit`.
+uint64_t ParseCount(const std::string &text, const std::string &name,
+                    uint64_t limit) {
+  bool isDigits = !text.empty() && text.find_first_not_of("0123456789") ==
+                                       std::string::npos;
+  uint64_t value = 0;
+  try {
+    value = isDigits ? std::stoull(text) : 0;
+  } catch (const std::exception &) {
+    value = 0;
+  }
+  if (value == 0 || value > limit) {
+    throw std::invalid_argument("Malformed " + name + ": " + text);
+  }
+  return value;
+}
+
+// Directories are searched recursively and keep their layout in the output
+// directory; a .txt argument lists one input file per line.
+std::vector<Job> CollectJobs(const std::vector<std::string> &arguments,
+                             const fs::path &outputDirectory) {
+  std::vector<Job> jobs;
+  for (const auto &argument : arguments) {
+    fs::path path(argument);
+    if (fs::is_directory(path)) {
+      for (const auto &entry : fs::recursive_directory_iterator(path)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".wav") {
+          jobs.push_back(
+              {entry.path(),
+               outputDirectory / fs::relative(entry.path(), path)});
+        }
+      }
+    } else if (path.extension() == ".txt") {
+      std::ifstream list(path);
+      for (std::string line; std::getline(list, line);) {
+        if (!line.empty()) {
+          jobs.push_back({line, outputDirectory / fs::path(line).filename()});
+        }
+      }
+    } else {
+      jobs.push_back({path, outputDirectory / path.filename()});
+    }
+  }
+  // Listed files are flattened to their names, so two of them may collide;
+  // concurrent workers would then overwrite each other's output.
+  std::map<fs::path, fs::path> outputs;
+  for (const auto &job : jobs) {
+    auto output = job.output.lexically_normal();
+    auto inserted = outputs.emplace(output, job.input);
+    if (!inserted.second) {
+      throw std::invalid_argument(
+          "Inputs " + inserted.first->second.string() + " and " +
+          job.input.string() + " both write " + output.string());
+    }
+  }
+  return jobs;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  size_t threads = std::max(1u, std::thread::hardware_concurrency());
+  std::string spec = "portion:0.8";
+  uint32_t sampleRate = 0;
+  std::string tracePath;
+  fs::path outputDirectory = "filtered";
+  std::vector<std::string> inputs;
+  for (int i = 1; i < argc; ++i) {
+    std::string argument = argv[i];
+    if ((argument == "-j" || argument == "-f" || argument == "-r" ||
+         argument == "-o" || argument == "-t") &&
+        i + 1 < argc) {
+      std::string value = argv[++i];
+      try {
+        if (argument == "-j") {
+          threads = ParseCount(value, "thread count", 1024);
+        } else if (argument == "-r") {
+          sampleRate = ParseCount(value, "sample rate", UINT32_MAX);
+        }
+      } catch (const std::exception &error) {
+        std::cerr << error.what() << "\n";
+        PrintUsage();
+        return 2;
+      }
+      if (argument == "-f") {
+        spec = value;
+      } else if (argument == "-t") {
+        tracePath = value;
+      } else if (argument == "-o") {
+        outputDirectory = value;
+      }
+    } else if (!argument.empty() && argument[0] == '-') {
+      PrintUsage();
+      return 2;
+    } else {
+      inputs.push_back(argument);
+    }
+  }
+  if (inputs.empty()) {
+    PrintUsage();
+    return 2;
+  }
+
+  Dsp::FilterSpec filterSpec;
+  std::vector<Job> jobs;
+  try {
+    filterSpec = Dsp::ParseFilterSpec(spec);
+    jobs = CollectJobs(inputs, outputDirectory);
+    if (!tracePath.empty()) {
+      Trace::Start(tracePath, Trace::FormatForPath(tracePath));
+    }
+  } catch (const std::exception &error) {
+    std::cerr << error.what() << "\n";
+    return 2;
+  }
+  threads = std::min(threads, std::max<size_t>(jobs.size(), 1));
+
+  std::mutex outputMutex;
+  std::atomic<size_t> next{0}, failed{0};
+  std::atomic<uint64_t> totalBytes{0};
+  auto start = std::chrono::steady_clock::now();
+  {
+    // Every worker owns one pipeline and keeps its buffers across files.
+    ThreadPool pool(threads);
+    std::vector<std::future<void>> workers;
+    for (size_t worker = 0; worker < threads; ++worker) {
+      workers.push_back(pool.Submit([&] {
+        Dsp::FilterPipeline pipeline(filterSpec, sampleRate);
+        for (size_t i = next++; i < jobs.size(); i = next++) {
+          const auto &job = jobs[i];
+          try {
+            fs::create_directories(job.output.parent_path());
+            auto stats = pipeline.Run(job.input.string(), job.output.string());
+            totalBytes += stats.bytes;
+            std::lock_guard<std::mutex> lock(outputMutex);
+            std::cout << job.input.string() << "\t" << stats.frames
+                      << " frames\t" << std::fixed << std::setprecision(3)
+                      << stats.seconds << " s\t" << std::setprecision(1)
+                      << stats.bytes / 1e6 / std::max(stats.seconds, 1e-9)
+                      << " MB/s\n";
+          } catch (const std::exception &error) {
+            ++failed;
+            std::lock_guard<std::mutex> lock(outputMutex);
+            std::cerr << job.input.string() << "\tfailed: " << error.what()
+                      << "\n";
+          }
+        }
+      }));
+    }
+    for (auto &worker : workers) {
+      worker.get();
+    }
+  }
+  double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+          .count();
+  std::cout << "Processed " << jobs.size() - failed << "/" << jobs.size()
+            << " files, " << std::fixed << std::setprecision(1)
+            << totalBytes / 1e6 << " MB in " << std::setprecision(3)
+            << seconds << " s (" << std::setprecision(1)
+            << totalBytes / 1e6 / std::max(seconds, 1e-9) << " MB/s)\n";
+  Trace::Stop();
+  return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,362 @@
+#include "FFT.h"
+#include "ParallelFFT.h"
+#include "WavReader.h"
+#include "WavWriter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace {
+struct Options {
+  size_t minSize = 1lu << 8lu;
+  size_t maxSize = 1lu << 24lu;
+  // Sizes up to this one are checked against a naive DFT in every bin,
+  // larger ones in a spread of bins.
+  size_t naiveLimit = 4096;
+  double minSeconds = 0.2;
+  // Threads for the pooled run of the complex transforms.
+  size_t threads = std::max(2u, std::thread::hardware_concurrency());
+  std::vector<uint64_t> fileMegabytes = {10, 100, 1000, 4096};
+  fs::path directory = fs::temp_directory_path();
+};
+
+void PrintUsage() {
+  std::cerr << "Usage: fft_bench [--min-size n] [--max-size n] "
+               "[--naive-limit n] [--min-time seconds] [--threads n] "
+               "[--files mb,mb,...] [--dir directory]\n"
+               "Prints tab separated rows:\n"
+               "  fft <plan|complex|real> <type> <direction> <size> <threads> "
+               "<ns/point> <error> <check>\n"
+               "  io <operation> <megabytes> <seconds> <GB/s>\n";
+}
+
+std::vector<size_t> TransformSizes(const Options &options) {
+  std::vector<size_t> sizes;
+  for (size_t size = 1; size <= options.maxSize; size <<= 1lu) {
+    sizes.push_back(size);
+  }
+  // Mixed radix, primes that go through Bluestein, and audio frame sizes.
+  for (size_t size : {1000lu, 1009lu, 4095lu, 10007lu, 44100lu, 48000lu,
+                      65537lu, 999983lu, 1000000lu, 9999991lu}) {
+    sizes.push_back(size);
+  }
+  sizes.erase(std::remove_if(sizes.begin(), sizes.end(),
+                             [&](size_t size) {
+                               return size < options.minSize ||
+                                      size > options.maxSize;
+                             }),
+              sizes.end());
+  std::sort(sizes.begin(), sizes.end());
+  return sizes;
+}
+
+// Runs `body` in growing batches until one takes at least `minSeconds` and
+// returns the best time per call of five such batches.
+template <typename F> double TimePerCall(F &&body, double minSeconds) {
+  using Clock = std::chrono::steady_clock;
+  size_t calls = 1;
+  double best = INFINITY;
+  for (int round = 0; round < 5;) {
+    auto start = Clock::now();
+    for (size_t i = 0; i < calls; ++i) {
+      body();
+    }
+    double seconds =
+        std::chrono::duration<double>(Clock::now() - start).count();
+    if (seconds < minSeconds / 5 && calls < (1lu << 30lu)) {
+      calls *= 2;
+      continue;
+    }
+    best = std::min(best, seconds / calls);
+    ++round;
+  }
+  return best;
+}
+
+using Exact = std::complex<long double>;
+
+// Naive DFT outputs at `bins`; the values are matched to the bins by index.
+struct Reference {
+  std::vector<size_t> bins;
+  std::vector<Exact> values;
+};
+
+// Every bin for sizes up to the naive limit, a spread of CHECKED_BINS above
+// it, so that even the largest sizes are checked against a direct sum.
+std::vector<size_t> CheckedBins(size_t size, const Options &options) {
+  const size_t CHECKED_BINS = 16;
+  std::vector<size_t> bins;
+  if (size <= options.naiveLimit) {
+    for (size_t k = 0; k < size; ++k) {
+      bins.push_back(k);
+    }
+    return bins;
+  }
+  for (size_t i = 0; i < CHECKED_BINS; ++i) {
+    bins.push_back((i * size / CHECKED_BINS + i) % size);
+  }
+  return bins;
+}
+
+// O(n) per bin in long double with exactly reduced angles. The root is
+// advanced by multiplication and recomputed every EXACT_STEP terms, which
+// keeps the reference well below double precision.
+Reference NaiveDft(const std::vector<Exact> &in, bool isInversed,
+                   std::vector<size_t> bins) {
+  const size_t EXACT_STEP = 64;
+  size_t size = in.size();
+  long double angle = (isInversed ? -2 : 2) * M_PIl / size;
+  Reference reference{std::move(bins), {}};
+  for (size_t k : reference.bins) {
+    Exact step = std::polar(1.0L, angle * k), root = 1, sum = 0;
+    for (size_t n = 0, power = 0; n < size; ++n) {
+      if (n % EXACT_STEP == 0) {
+        root = std::polar(1.0L, angle * power);
+      }
+      sum += in[n] * root;
+      root *= step;
+      power = power + k < size ? power + k : power + k - size;
+    }
+    reference.values.push_back(isInversed ? sum / (long double)size : sum);
+  }
+  return reference;
+}
+
+template <typename T>
+double RelativeError(const std::vector<std::complex<T>> &values,
+                     const Reference &reference) {
+  long double error = 0, norm = 0;
+  for (size_t i = 0; i < reference.bins.size(); ++i) {
+    const auto &value = values[reference.bins[i]];
+    error += std::norm(Exact(value.real(), value.imag()) - reference.values[i]);
+    norm += std::norm(reference.values[i]);
+  }
+  return norm > 0 ? double(std::sqrt(error / norm)) : 0.;
+}
+
+double RelativeError(const std::vector<Exact> &values,
+                     const std::vector<Exact> &expected) {
+  long double error = 0, norm = 0;
+  for (size_t i = 0; i < values.size(); ++i) {
+    error += std::norm(values[i] - expected[i]);
+    norm += std::norm(expected[i]);
+  }
+  return norm > 0 ? double(std::sqrt(error / norm)) : 0.;
+}
+
+void PrintTransform(const char *entry, const char *type, bool isInversed,
+                    size_t size, size_t threads, double seconds, double error,
+                    const char *check) {
+  std::cout << "fft\t" << entry << "\t" << type << "\t"
+            << (isInversed ? "inverse" : "forward") << "\t" << size << "\t"
+            << threads << "\t" << std::fixed << std::setprecision(3)
+            << seconds * 1e9 / size << "\t" << std::scientific
+            << std::setprecision(2) << error << "\t" << check
+            << std::defaultfloat << std::endl;
+}
+
+// A cached plan executed directly, in the scalar type `T`.
+template <typename T>
+void BenchmarkPlan(const char *type, const std::vector<Exact> &input,
+                   bool isInversed, const Reference &reference,
+                   const char *check, const Options &options) {
+  size_t size = input.size();
+  auto plan = FFT::GetPlan<T>(size, isInversed);
+  std::vector<std::complex<T>> in(input.begin(), input.end()), out(size);
+  double seconds = TimePerCall([&] { plan->Execute(in.data(), out.data()); },
+                               options.minSeconds);
+  plan->Execute(in.data(), out.data());
+  PrintTransform("plan", type, isInversed, size, 1, seconds,
+                 RelativeError(out, reference), check);
+}
+
+// For every size: the float, double and long double plans, then the public
+// entry points FFT::Transform and FFT::RealTransform with their inverses, so
+// conversions, plan lookup and pool dispatch are included. Complex sizes
+// the pool can split run once more with `options.threads` threads. The
+// inputs are exact in float, so one reference serves all scalar types.
+void BenchmarkTransforms(const Options &options) {
+  std::mt19937_64 random(42);
+  std::uniform_real_distribution<float> uniform(-1, 1);
+  for (size_t size : TransformSizes(options)) {
+    std::vector<Exact> input(size);
+    for (auto &value : input) {
+      value = {uniform(random), uniform(random)};
+    }
+    auto bins = CheckedBins(size, options);
+    const char *check = size <= options.naiveLimit ? "naive" : "naive_bins";
+
+    for (bool isInversed : {false, true}) {
+      auto reference = NaiveDft(input, isInversed, bins);
+      BenchmarkPlan<float>("float", input, isInversed, reference, check,
+                           options);
+      BenchmarkPlan<double>("double", input, isInversed, reference, check,
+                            options);
+      BenchmarkPlan<long double>("long_double", input, isInversed, reference,
+                                 check, options);
+
+      std::vector<size_t> pools = {1};
+      if (FFT::CanRunInParallel(size)) {
+        pools.push_back(options.threads);
+      }
+      for (size_t threads : pools) {
+        FFT::SetThreadCount(threads);
+        std::vector<FFT::Complex> out;
+        double seconds =
+            TimePerCall([&] { out = FFT::Transform(input, isInversed); },
+                        options.minSeconds);
+        PrintTransform("complex", "long_double", isInversed, size, threads,
+                       seconds, RelativeError(out, reference), check);
+      }
+      FFT::SetThreadCount(1);
+    }
+
+    std::vector<FFT::Real> samples(size);
+    std::vector<Exact> signal(size);
+    for (size_t i = 0; i < size; ++i) {
+      samples[i] = input[i].real();
+      signal[i] = samples[i];
+    }
+    std::vector<FFT::Complex> spectrum;
+    double seconds = TimePerCall(
+        [&] { spectrum = FFT::RealTransform(samples); }, options.minSeconds);
+    std::vector<size_t> spectrumBins;
+    for (size_t k : bins) {
+      if (k < spectrum.size()) {
+        spectrumBins.push_back(k);
+      }
+    }
+    auto reference = NaiveDft(signal, false, spectrumBins);
+    PrintTransform("real", "long_double", false, size, 1, seconds,
+                   RelativeError(spectrum, reference), check);
+
+    std::vector<FFT::Real> restored;
+    seconds = TimePerCall(
+        [&] { restored = FFT::InverseRealTransform(spectrum, size); },
+        options.minSeconds);
+    std::vector<Exact> roundtrip(restored.begin(), restored.end());
+    PrintTransform("real", "long_double", true, size, 1, seconds,
+                   RelativeError(roundtrip, signal), "roundtrip");
+  }
+}
+
+// Stereo 16-bit noise of about `megabytes`, streamed through Wav::Writer.
+void WriteSyntheticFile(const fs::path &path, uint64_t megabytes) {
+  Wav::Header header{};
+  header.audioFormat = 1;
+  header.numChannels = 2;
+  header.sampleRate = 48000;
+  header.bitsPerSample = 16;
+  header.blockAlign = 4;
+  header.byteRate = header.sampleRate * header.blockAlign;
+  Wav::Writer writer(path.string(), header);
+  std::vector<Wav::File::Byte> chunk(1lu << 20lu);
+  std::mt19937 random(7);
+  for (auto &byte : chunk) {
+    byte = random();
+  }
+  for (uint64_t written = 0; written < megabytes; ++written) {
+    writer.Write(chunk);
+  }
+  writer.Close();
+}
+
+void PrintIo(const char *operation, uint64_t megabytes, uint64_t bytes,
+             double seconds) {
+  std::cout << "io\t" << operation << "\t" << megabytes << "\t" << std::fixed
+            << std::setprecision(3) << seconds << "\t" << bytes / 1e9 / seconds
+            << std::defaultfloat << std::endl;
+}
+
+void BenchmarkFiles(const Options &options) {
+  using Clock = std::chrono::steady_clock;
+  auto elapsed = [](Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+  };
+  for (uint64_t megabytes : options.fileMegabytes) {
+    fs::path input = options.directory / "fft_bench_input.wav";
+    fs::path output = options.directory / "fft_bench_output.wav";
+    auto start = Clock::now();
+    WriteSyntheticFile(input, megabytes);
+    uint64_t bytes = fs::file_size(input);
+    PrintIo("write", megabytes, bytes, elapsed(start));
+
+    // Loads run against a warm page cache, as the batch jobs mostly do.
+    {
+      Wav::File file;
+      start = Clock::now();
+      file.Load(input.string());
+      PrintIo("load", megabytes, bytes, elapsed(start));
+      start = Clock::now();
+      file.Save(output.string());
+      PrintIo("save", megabytes, bytes, elapsed(start));
+    }
+    {
+      Wav::File file;
+      start = Clock::now();
+      file.Map(input.string());
+      volatile uint64_t sum = 0;
+      for (auto byte : file.Data()) {
+        sum += byte;
+      }
+      PrintIo("map+scan", megabytes, bytes, elapsed(start));
+    }
+    fs::remove(input);
+    fs::remove(output);
+  }
+}
+
+std::vector<uint64_t> ParseList(const std::string &text) {
+  std::vector<uint64_t> values;
+  std::istringstream list(text);
+  std::string value;
+  while (std::getline(list, value, ',')) {
+    if (!value.empty()) {
+      values.push_back(std::stoull(value));
+    }
+  }
+  return values;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    std::string argument = argv[i];
+    if (i + 1 >= argc) {
+      PrintUsage();
+      return 2;
+    }
+    std::string value = argv[++i];
+    if (argument == "--min-size") {
+      options.minSize = std::stoul(value);
+    } else if (argument == "--max-size") {
+      options.maxSize = std::stoul(value);
+    } else if (argument == "--naive-limit") {
+      options.naiveLimit = std::stoul(value);
+    } else if (argument == "--min-time") {
+      options.minSeconds = std::stod(value);
+    } else if (argument == "--threads") {
+      options.threads = std::max<size_t>(std::stoul(value), 2);
+    } else if (argument == "--files") {
+      options.fileMegabytes = ParseList(value);
+    } else if (argument == "--dir") {
+      options.directory = value;
+    } else {
+      PrintUsage();
+      return 2;
+    }
+  }
+
+  BenchmarkTransforms(options);
+  BenchmarkFiles(options);
+}
@@ -1,31 +1,199 @@
-#include "FFT.h"
+#include "Alignment.h"
+#include "Convolver.h"
+#include "Realtime.h"
+#include "FilterPipeline.h"
+#include "Spectrogram.h"
+#include "ToneDetector.h"
+#include "Trace.h"
 #include "WavReader.h"
 
-#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <thread>
+#include <unistd.h>
 
-int main() {
-  const double PORTION = 0.8;
+namespace {
+using Arguments = std::vector<std::string>;
+
+double ParseDouble(const std::string &text, const std::string &name) {
+  size_t parsed = 0;
+  double value = 0;
+  try {
+    value = std::stod(text, &parsed);
+  } catch (const std::exception &) {
+    parsed = 0;
+  }
+  if (parsed == 0 || parsed != text.size()) {
+    throw std::invalid_argument("Malformed " + name + ": " + text);
+  }
+  return value;
+}
+
+// Digits only, so signs and fractions are refused, between 1 and `limit`.
+uint64_t ParseUnsigned(const std::string &text, const std::string &name,
+                       uint64_t limit) {
+  bool isDigits = !text.empty() && text.find_first_not_of("0123456789") ==
+                                       std::string::npos;
+  uint64_t value = 0;
+  try {
+    value = isDigits ? std::stoull(text) : 0;
+  } catch (const std::exception &) {
+    value = 0;
+  }
+  if (value == 0 || value > limit) {
+    throw std::invalid_argument("Malformed " + name + ": " + text);
+  }
+  return value;
+}
+
+// filter [input.wav [output.wav [filter spec [sample rate]]]]
+int Filter(const Arguments &args) {
+  std::string inputPath = args.size() > 0 ? args[0] : "../samples/speech.wav";
+  std::string outputPath = args.size() > 1 ? args[1] : "../samples/copy.wav";
+  std::string spec = args.size() > 2 ? args[2] : "portion:0.8";
+  uint32_t sampleRate =
+      args.size() > 3 ? ParseUnsigned(args[3], "sample rate", UINT32_MAX) : 0;
 
   Wav::File file;
-  file.Load("../samples/speech.wav");
-  std::cout << "File loaded! Its info:\n" << file << std::endl;
+  file.Open(inputPath);
+  std::cout << "File opened! Its info:\n" << file << std::endl;
+
+  Dsp::FilterPipeline pipeline(Dsp::ParseFilterSpec(spec), sampleRate,
+                               std::thread::hardware_concurrency());
+  pipeline.Run(file, outputPath);
+  std::cout << "Transformed file saved!\n";
+  return 0;
+}
 
-  auto data = file.ExtractData();
-  auto transformed = FFT::Transform(data);
+// convolve input.wav impulse.wav output.wav [block size]
+int Convolve(const Arguments &args) {
+  if (args.size() < 3) {
+    std::cerr << "Usage: WavReader convolve input.wav impulse.wav output.wav "
+                 "[block size]\n";
+    return 1;
+  }
+  size_t blockSize =
+      args.size() > 3 ? ParseUnsigned(args[3], "block size", SIZE_MAX) : 1024;
+  Dsp::ConvolveFile(args[0], args[1], args[2], blockSize);
+  std::cout << "Convolved file saved!\n";
+  return 0;
+}
 
-  size_t fillingStart = transformed.size() * (1. - PORTION);
-  size_t fillingEnd = transformed.size();
-  std::fill(transformed.begin() + fillingStart,
-            transformed.begin() + fillingEnd, 0);
-  auto result = FFT::Transform(transformed, true);
+// spectrogram input.wav output.fea [frame=1024,hop=256,mel=0]
+int Spectrogram(const Arguments &args) {
+  if (args.size() < 2) {
+    std::cerr << "Usage: WavReader spectrogram input.wav output.fea "
+                 "[frame=1024,hop=256,mel=0]\n";
+    return 1;
+  }
+  auto spec = Dsp::ParseSpectrogramSpec(args.size() > 2 ? args[2] : "");
+  auto frames = Dsp::ExtractFeatures(args[0], args[1], spec);
+  std::cout << "Features of " << frames << " frames saved!\n";
+  return 0;
+}
 
-  std::vector<Wav::File::Byte> newData;
-  newData.reserve(data.size());
-  for (size_t i = 0; i < data.size(); ++i) {
-    newData.push_back(std::floor(result[i].real() + 0.5));
+// align reference.wav other.wav
+int Align(const Arguments &args) {
+  if (args.size() < 2) {
+    std::cerr << "Usage: WavReader align reference.wav other.wav\n";
+    return 1;
   }
+  Wav::File reference;
+  reference.Open(args[0]);
+  auto alignment = Dsp::AlignFiles(args[0], args[1]);
+  std::cout << "Lag: " << alignment.lag << " frames ("
+            << double(alignment.lag) / reference.GetHeader().sampleRate
+            << " s), score: " << alignment.score << std::endl;
+  return 0;
+}
 
-  file.UpdateData(newData);
-  file.Save("../samples/copy.wav");
-  std::cout << "Transformed file saved!\n";
-}
\ No newline at end of file
+// tones input.wav [dtmf|f1,f2,... [block seconds [threshold dB]]]
+int Tones(const Arguments &args) {
+  if (args.empty()) {
+    std::cerr << "Usage: WavReader tones input.wav [dtmf|f1,f2,... "
+                 "[block seconds [threshold dB]]]\n";
+    return 1;
+  }
+  auto frequencies = Dsp::ParseFrequencies(args.size() > 1 ? args[1] : "dtmf");
+  double blockSeconds =
+      args.size() > 2 ? ParseDouble(args[2], "block length") : 0.02;
+  double threshold = args.size() > 3 ? ParseDouble(args[3], "threshold") : -30.;
+  size_t skipped = Dsp::ScanTones(
+      args[0], frequencies, blockSeconds, threshold,
+      [&](const Dsp::ToneDetection &detection) {
+        std::cout << detection.time << " s\t" << detection.frequency
+                  << " Hz\t" << detection.level << " dB\n";
+      });
+  if (skipped > 0) {
+    std::cerr << "Skipped " << skipped
+              << " trailing frames, less than half a block." << std::endl;
+  }
+  return 0;
+}
+
+// realtime rate channels [spec [block frames [frame size [bits]]]]
+int Realtime(const Arguments &args) {
+  if (args.size() < 2) {
+    std::cerr << "Usage: WavReader realtime rate channels [filter spec "
+                 "[block frames [frame size [bits]]]] < in.pcm > out.pcm\n";
+    return 1;
+  }
+  Dsp::RealtimeConfig config;
+  config.sampleRate = ParseUnsigned(args[0], "sample rate", UINT32_MAX);
+  config.numChannels = ParseUnsigned(args[1], "channel count", UINT16_MAX);
+  std::string spec = args.size() > 2 ? args[2] : "portion:0.8";
+  if (args.size() > 3) {
+    config.blockFrames = ParseUnsigned(args[3], "block frames", SIZE_MAX);
+  }
+  if (args.size() > 4) {
+    config.frameSize = ParseUnsigned(args[4], "frame size", SIZE_MAX);
+  }
+  if (args.size() > 5) {
+    config.bitsPerSample = ParseUnsigned(args[5], "bits", UINT16_MAX);
+  }
+  Dsp::RealtimeFilter filter(Dsp::ParseFilterSpec(spec), config);
+  auto stats = filter.Run(STDIN_FILENO, STDOUT_FILENO);
+  std::cerr << "Blocks: " << stats.blocks
+            << ", worst latency: " << stats.worstLatency * 1e3
+            << " ms, mean latency: " << stats.meanLatency * 1e3
+            << " ms, filter delay: " << stats.filterDelay * 1e3
+            << " ms, input stalls: " << stats.inputStalls << std::endl;
+  return 0;
+}
+
+const std::map<std::string, std::function<int(const Arguments &)>> COMMANDS = {
+    {"filter", Filter},
+    {"align", Align},
+    {"convolve", Convolve},
+    {"realtime", Realtime},
+    {"spectrogram", Spectrogram},
+    {"tones", Tones},
+};
+} // namespace
+
+// Usage: WavReader [--trace file] [command] [arguments]; without a known
+// command the arguments go to filter. A trace file ending in .jsonl gets one
+// JSON object per line, anything else a Chrome trace.
+int main(int argc, char **argv) {
+  Arguments args(argv + 1, argv + argc);
+  if (args.size() >= 2 && args[0] == "--trace") {
+    Trace::Start(args[1], Trace::FormatForPath(args[1]));
+    args.erase(args.begin(), args.begin() + 2);
+  }
+  auto command = args.empty() ? COMMANDS.end() : COMMANDS.find(args[0]);
+  int result = 0;
+  try {
+    if (command == COMMANDS.end()) {
+      result = Filter(args);
+    } else {
+      args.erase(args.begin());
+      result = command->second(args);
+    }
+  } catch (const std::exception &error) {
+    std::cerr << error.what() << std::endl;
+    result = 1;
+  }
+  Trace::Stop();
+  return result;
+}